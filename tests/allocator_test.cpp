@@ -1,12 +1,168 @@
 #include <common/allocator.h>
+#include <common/clock.h>
+#include <common/logger.h>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include <doctest/doctest.h>
 
+#include <random>
+#include <set>
+#include <vector>
+
 
 using namespace tyrtech;
 
 
+class set_allocator
+{
+public:
+    uint32_t allocate(uint32_t size)
+    {
+        auto it = m_free_set.lower_bound(static_cast<uint64_t>(size) << 32);
+
+        if (it == m_free_set.end())
+        {
+            return static_cast<uint32_t>(-1);
+        }
+
+        uint32_t idx = *it & 0xffffffffU;
+        uint32_t available_size = *it >> 32;
+
+        remove(idx, available_size);
+
+        if (available_size > size)
+        {
+            insert(idx + size, available_size - size);
+        }
+
+        m_size += size;
+
+        return idx;
+    }
+
+    void free(uint32_t idx, uint32_t size)
+    {
+        m_size -= size;
+
+        auto it = m_idx_set.lower_bound(static_cast<uint64_t>(idx) << 32);
+
+        if (it != m_idx_set.end() && idx + size == (*it >> 32))
+        {
+            uint32_t next_size = *it & 0xffffffffU;
+
+            remove(idx + size, next_size);
+            size += next_size;
+        }
+
+        it = m_idx_set.lower_bound(static_cast<uint64_t>(idx) << 32);
+
+        if (it != m_idx_set.begin())
+        {
+            --it;
+
+            uint32_t prev_idx = *it >> 32;
+            uint32_t prev_size = *it & 0xffffffffU;
+
+            if (prev_idx + prev_size == idx)
+            {
+                remove(prev_idx, prev_size);
+
+                idx = prev_idx;
+                size += prev_size;
+            }
+        }
+
+        insert(idx, size);
+    }
+
+    void extend(uint32_t size)
+    {
+        m_size += size;
+        free(m_max_idx, size);
+
+        m_max_idx += size;
+    }
+
+    uint32_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    using set_t =
+            std::set<uint64_t>;
+
+private:
+    set_t m_free_set;
+    set_t m_idx_set;
+
+    uint32_t m_max_idx{0};
+    uint32_t m_size{0};
+
+private:
+    void insert(uint32_t idx, uint32_t size)
+    {
+        m_free_set.insert((static_cast<uint64_t>(size) << 32) | idx);
+        m_idx_set.insert((static_cast<uint64_t>(idx) << 32) | size);
+    }
+
+    void remove(uint32_t idx, uint32_t size)
+    {
+        m_free_set.erase((static_cast<uint64_t>(size) << 32) | idx);
+        m_idx_set.erase((static_cast<uint64_t>(idx) << 32) | size);
+    }
+};
+
+
+struct extent
+{
+    uint32_t idx;
+    uint32_t size;
+};
+
+using extents_t =
+        std::vector<extent>;
+
+
+template<typename Allocator>
+uint64_t churn(Allocator* a, uint32_t iterations)
+{
+    std::mt19937 rng(1);
+    extents_t extents;
+
+    a->extend(1U << 20);
+
+    auto t1 = clock::now();
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        if (extents.size() != 0 && (rng() % 2 == 0 || a->size() > (3U << 18)))
+        {
+            uint32_t j = rng() % extents.size();
+
+            a->free(extents[j].idx, extents[j].size);
+
+            extents[j] = extents.back();
+            extents.pop_back();
+        }
+        else
+        {
+            uint32_t size = 1 + (rng() % 64);
+            uint32_t idx = a->allocate(size);
+
+            if (idx != static_cast<uint32_t>(-1))
+            {
+                extents.push_back(extent{idx, size});
+            }
+        }
+    }
+
+    auto t2 = clock::now();
+
+    return t2 - t1;
+}
+
+
 TEST_CASE("test1")
 {
     allocator a;
@@ -65,4 +221,172 @@ TEST_CASE("test1")
         CHECK(a.allocate(10) == 0);
         CHECK(a.size() == 10);
     }
+
+    SUBCASE("sub4")
+    {
+        CHECK(a.reserve(1, 2) == true);
+        CHECK(a.size() == 2);
+
+        CHECK(a.reserve(2, 1) == false);
+        CHECK(a.reserve(4, 2) == false);
+
+        CHECK(a.allocate(1) == 0);
+        CHECK(a.allocate(1) == 3);
+        CHECK(a.allocate(1) == 4);
+        CHECK(a.size() == 5);
+
+        a.free(1, 2);
+        CHECK(a.size() == 3);
+
+        CHECK(a.reserve(2, 1) == true);
+        CHECK(a.allocate(1) == 1);
+    }
+}
+
+
+TEST_CASE("test2")
+{
+    allocator a;
+
+    std::mt19937 rng(0);
+
+    std::vector<bool> used;
+    extents_t extents;
+
+    SUBCASE("random")
+    {
+        for (uint32_t i = 0; i < 100000; i++)
+        {
+            uint32_t op = rng() % 16;
+
+            if (op == 0)
+            {
+                uint32_t size = 1 + rng() % 256;
+
+                a.extend(size);
+                used.resize(used.size() + size, false);
+            }
+            else if (op < 7 && extents.size() != 0)
+            {
+                uint32_t j = rng() % extents.size();
+
+                a.free(extents[j].idx, extents[j].size);
+
+                for (uint32_t k = 0; k < extents[j].size; k++)
+                {
+                    used[extents[j].idx + k] = false;
+                }
+
+                extents[j] = extents.back();
+                extents.pop_back();
+            }
+            else if (op < 9 && used.size() != 0)
+            {
+                uint32_t idx = rng() % used.size();
+                uint32_t size = 1 + rng() % 8;
+
+                bool available = idx + size <= used.size();
+
+                for (uint32_t k = 0; available == true && k < size; k++)
+                {
+                    available = used[idx + k] == false;
+                }
+
+                REQUIRE(a.reserve(idx, size) == available);
+
+                if (available == true)
+                {
+                    for (uint32_t k = 0; k < size; k++)
+                    {
+                        used[idx + k] = true;
+                    }
+
+                    extents.push_back(extent{idx, size});
+                }
+            }
+            else
+            {
+                uint32_t size = 1 + rng() % 64;
+                uint32_t idx = a.allocate(size);
+
+                if (idx == static_cast<uint32_t>(-1))
+                {
+                    continue;
+                }
+
+                REQUIRE(idx + size <= used.size());
+
+                for (uint32_t k = 0; k < size; k++)
+                {
+                    REQUIRE(used[idx + k] == false);
+                    used[idx + k] = true;
+                }
+
+                extents.push_back(extent{idx, size});
+            }
+
+            uint32_t size = 0;
+
+            for (auto&& e : extents)
+            {
+                size += e.size;
+            }
+
+            REQUIRE(a.size() == size);
+            REQUIRE(a.capacity() == used.size());
+            REQUIRE(a.full() == (size == used.size()));
+        }
+    }
+
+    SUBCASE("serialize")
+    {
+        a.extend(10000);
+
+        for (uint32_t i = 0; i < 2000; i++)
+        {
+            uint32_t size = 1 + rng() % 8;
+            uint32_t idx = a.allocate(size);
+
+            REQUIRE(idx != static_cast<uint32_t>(-1));
+            extents.push_back(extent{idx, size});
+        }
+
+        for (uint32_t i = 0; i < extents.size(); i += 2)
+        {
+            a.free(extents[i].idx, extents[i].size);
+        }
+
+        allocator b;
+        b.deserialize(a.serialize());
+
+        CHECK(b.capacity() == a.capacity());
+        CHECK(b.size() == a.size());
+        CHECK(b.serialize() == a.serialize());
+
+        for (uint32_t i = 1; i < extents.size(); i += 2)
+        {
+            CHECK(b.reserve(extents[i].idx, extents[i].size) == false);
+        }
+
+        for (uint32_t i = 0; i < extents.size(); i += 2)
+        {
+            CHECK(b.reserve(extents[i].idx, extents[i].size) == true);
+        }
+    }
+}
+
+TEST_CASE("benchmark")
+{
+    constexpr uint32_t iterations{2000000};
+
+    allocator a;
+    set_allocator b;
+
+    uint64_t d1 = churn(&a, iterations);
+    uint64_t d2 = churn(&b, iterations);
+
+    logger::notice("allocator: {} ops in {:.3f} s, {:.2f} Mops/s",
+                   iterations, d1 / 1000000000., iterations * 1000. / d1);
+    logger::notice("set allocator: {} ops in {:.3f} s, {:.2f} Mops/s",
+                   iterations, d2 / 1000000000., iterations * 1000. / d2);
 }
@@ -32,7 +32,7 @@ struct test_cb : public tyrdbs::ushard::meta_callback
 
 void test()
 {
-    storage::initialize(io::file::create("_test/{}", uuid()), 18, 14, false);
+    storage::initialize(io::file::create("_test/{}", uuid()), 18, 14, false, false, false);
 
     auto c = std::make_shared<tyrdbs::collection>("test");
 
@@ -60,7 +60,7 @@ int main()
     io::initialize(4096);
     io::file::initialize(32);
 
-    tyrdbs::cache::initialize(12);
+    tyrdbs::cache::initialize(32UL << 20);
 
     gt::create_thread(test);
     gt::run();
@@ -4,6 +4,7 @@
 #include <io/engine.h>
 #include <io/uri.h>
 #include <net/rpc_client.h>
+#include <storage/common.h>
 #include <tyrdbs/cache.h>
 
 #include <crc32c.h>
@@ -48,10 +49,10 @@ void dump_thread(const std::string_view& uri,
         {
             auto extent = extents.value();
 
-            uint32_t page = extent >> 32;
-            uint32_t pages = extent & 0xffffffffU;
-
-            logger::notice(" page: {}, pages: {}", page, pages);
+            logger::notice(" device: {}, page: {}, pages: {}",
+                           storage::extent_device(extent),
+                           storage::extent_page(extent),
+                           storage::extent_pages(extent));
         }
     }
 }
@@ -96,12 +97,12 @@ int main(int argc, const char* argv[])
                   "14",
                   {"write cache size expressed as 2^bits (default is 14)"});
 
-    cmd.add_param("block-cache-bits",
+    cmd.add_param("block-cache-size",
                   nullptr,
-                  "block-cache-bits",
-                  "bits",
-                  "12",
-                  {"block cache size expressed as 2^bits (default is 12)"});
+                  "block-cache-size",
+                  "MB",
+                  "32",
+                  {"block cache size in megabytes (default is 32)"});
 
     cmd.add_param("uri",
                   "<uri>",
@@ -126,7 +127,7 @@ int main(int argc, const char* argv[])
     io::file::initialize(cmd.get<uint32_t>("storage-queue-depth"));
     io::channel::initialize(cmd.get<uint32_t>("network-queue-depth"));
 
-    tyrdbs::cache::initialize(cmd.get<uint32_t>("block-cache-bits"));
+    tyrdbs::cache::initialize(cmd.get<uint64_t>("block-cache-size") << 20);
 
     gt::create_thread(dump_thread,
                       cmd.get<std::string_view>("uri"),
@@ -1,11 +1,12 @@
 #include <common/cmd_line.h>
-#include <common/cpu_sched.h>
 #include <common/ring_queue.h>
 #include <gt/engine.h>
 #include <gt/async.h>
 #include <io/engine.h>
+#include <io/cores.h>
 #include <io/uri.h>
 #include <net/rpc_server.h>
+#include <storage/wal.h>
 #include <tyrdbs/ushard.h>
 #include <tyrdbs/cache.h>
 
@@ -15,6 +16,8 @@
 #include <tests/snapshot.json.h>
 
 #include <crc32c.h>
+#include <map>
+#include <set>
 
 
 using namespace tyrtech;
@@ -26,16 +29,74 @@ namespace module {
 using namespace tests::collections;
 
 
+void print_histogram(const char* name, const storage::fragmentation_stats::histogram_t& histogram)
+{
+    logger::notice("{}:", name);
+
+    for (uint32_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] != 0)
+        {
+            logger::notice("  {:>8}-{:<8} {}", 1U << i, (2U << i) - 1, histogram[i]);
+        }
+    }
+}
+
+void print_fragmentation()
+{
+    auto stats = storage::fragmentation();
+
+    print_histogram("free ranges [pages]", stats.free_ranges);
+    print_histogram("extents per file", stats.file_extents);
+
+    logger::notice("relocated:   {} files, {} pages", stats.relocated_files, stats.relocated_pages);
+}
+
+void print_stacks()
+{
+    auto stats = gt::stacks_stats();
+
+    for (uint32_t i = 0; i < stats.size(); i++)
+    {
+        if (stats[i].contexts == 0)
+        {
+            continue;
+        }
+
+        logger::notice("stacks {:>2} KB: {} contexts, {} sampled, high water mark {} bytes, {} KB reserved",
+                       static_cast<uint32_t>(gt::stack_sizes[i]) >> 10,
+                       stats[i].contexts,
+                       stats[i].sampled,
+                       stats[i].high_water_mark,
+                       stats[i].reserved >> 10);
+    }
+}
+
+
+static constexpr uint32_t invalid_core{static_cast<uint32_t>(-1)};
+
+
+struct impl;
+
+thread_local impl* __local{nullptr};
+
+
 struct impl : private disallow_copy
 {
     struct context : private disallow_copy
     {
+        using fetches_t =
+                std::unordered_map<uint64_t, uint32_t>;
+
         struct impl* impl;
+        uint64_t id{0};
 
-        tyrdbs::ushard::slices_t snapshot;
+        fetches_t fetches;
+        uint32_t snapshot_core{invalid_core};
 
-        context(struct impl* impl)
+        context(struct impl* impl, uint64_t id)
           : impl(impl)
+          , id(id)
         {
         }
 
@@ -43,6 +104,7 @@ struct impl : private disallow_copy
         {
             if (impl != nullptr)
             {
+                impl->release_snapshot(this);
                 impl->print_stats();
             }
         }
@@ -57,13 +119,22 @@ struct impl : private disallow_copy
             impl = other.impl;
             other.impl = nullptr;
 
+            id = other.id;
+            fetches = std::move(other.fetches);
+            snapshot_core = other.snapshot_core;
+
             return *this;
         }
     };
 
     context create_context(const std::shared_ptr<io::channel>& remote)
     {
-        return context(this);
+        wait_for_recovery();
+
+        uint64_t id = static_cast<uint64_t>(io::cores::current()) << 48;
+        id |= ++contexts;
+
+        return context(this, id);
     }
 
     using merge_request_t =
@@ -82,10 +153,19 @@ struct impl : private disallow_copy
 
         void add(const tyrtech::tyrdbs::ushard::slice_ptr& slice) override
         {
+            storage::add_file(ushard, slice->descriptor());
+            storage::commit();
         }
 
         void remove(const tyrtech::tyrdbs::ushard::slices_t& slices) override
         {
+            for (auto&& slice : slices)
+            {
+                storage::remove_file(slice->descriptor().cache_id);
+            }
+
+            storage::commit();
+
             for (auto&& slice : slices)
             {
                 slice->unlink();
@@ -137,6 +217,101 @@ struct impl : private disallow_copy
         }
     }
 
+    void recover_thread()
+    {
+        auto files = storage::recover();
+
+        for (auto&& it : files)
+        {
+            auto&& ushard = ushards.find(it.second.owner);
+
+            if (ushard == ushards.end())
+            {
+                throw runtime_error("{}: unknown ushard {}", storage::path(), it.second.owner);
+            }
+
+            auto reader = storage::create_reader(std::move(it.second.descriptor));
+            auto slice = std::make_shared<tyrdbs::slice>(std::move(reader));
+
+            idx = std::max(idx, slice->max_idx() + 1);
+
+            cb cb(it.second.owner, this);
+            ushard->second->load(std::move(slice), &cb);
+        }
+
+        logger::notice("recovered {} slices", files.size());
+
+        replay(wal.recover());
+
+        recovered = true;
+        recovered_cond.signal_all();
+
+        if (defragment_interval != 0)
+        {
+            storage::start_defragmenter(defragment_interval);
+        }
+    }
+
+    void replay(const storage::wal::records_t& records)
+    {
+        uint64_t replayed = 0;
+
+        for (auto&& record : records)
+        {
+            writer w;
+
+            if (load(record, &w) == false || owned(w) == false)
+            {
+                logger::warning("invalid transaction record, ignoring the rest of the log");
+                break;
+            }
+
+            apply(&w);
+
+            idx = std::max(idx, w.idx + 1);
+            replayed++;
+        }
+
+        logger::notice("replayed {} transactions", replayed);
+
+        checkpoint();
+    }
+
+    void checkpoint()
+    {
+        if (checkpoint_in_progress == true)
+        {
+            return;
+        }
+
+        checkpoint_in_progress = true;
+
+        while (commits_in_progress != 0)
+        {
+            checkpoint_cond.wait();
+        }
+
+        auto jobs = gt::async::create_jobs();
+
+        for (auto&& ushard : ushards)
+        {
+            auto f = [this, &ushard]
+            {
+                cb cb(ushard.first, this);
+                ushard.second->flush(&cb);
+            };
+
+            jobs.run(std::move(f));
+        }
+
+        jobs.wait();
+
+        wal.reset();
+
+        checkpoint_in_progress = false;
+        checkpoint_cond.signal_all();
+    }
+
     template<typename T>
     uint64_t id(const T& obj)
     {
@@ -149,23 +324,15 @@ struct impl : private disallow_copy
     {
         if (request.has_handle() == false)
         {
-            while (tyrdbs::slice::count() > max_slices)
-            {
-                gt::yield();
-            }
-
-            writer w;
-            w.idx = idx++;
+            auto& t = transactions[++handles];
+            update_entries(request.get_parser(), request.data(), &t);
 
-            update_entries(request.get_parser(), request.data(), &w);
-
-            writers[idx] = std::move(w);
-            response->add_handle(idx);
+            response->add_handle(handles);
         }
         else
         {
-            auto& w = writers[request.handle()];
-            update_entries(request.get_parser(), request.data(), &w);
+            auto& t = transactions[request.handle()];
+            update_entries(request.get_parser(), request.data(), &t);
         }
     }
 
@@ -173,37 +340,219 @@ struct impl : private disallow_copy
                        commit_update::response_builder_t* response,
                        context* ctx)
     {
-        auto& w = writers[request.handle()];
+        auto& t = transactions[request.handle()];
+        auto jobs = gt::async::create_jobs();
 
-        for (auto&& slice : w.slices)
+        for (auto&& entries : t.entries)
         {
-            cb cb(slice.first, this);
+            auto f = [&entries]
+            {
+                io::cores::call(entries.first, [&entries] { __local->commit(entries.second); });
+            };
 
-            ushards[slice.first]->add(slice.second->commit(), &cb);
+            jobs.run(std::move(f));
         }
 
-        writers.erase(request.handle());
+        jobs.wait();
+
+        transactions.erase(request.handle());
     }
 
     void rollback_update(const rollback_update::request_parser_t& request,
                          rollback_update::response_builder_t* response,
                          context* ctx)
     {
-        writers.erase(request.handle());
+        transactions.erase(request.handle());
     }
 
     void fetch_data(const fetch_data::request_parser_t& request,
                     fetch_data::response_builder_t* response,
                     context* ctx)
     {
+        uint32_t core;
+
+        if (request.has_handle() == false)
+        {
+            core = owner(request.ushard() % ushards_num);
+        }
+        else
+        {
+            core = ctx->fetches[request.handle()];
+            ctx->fetches.erase(request.handle());
+        }
+
+        uint64_t handle = 0;
+
+        io::cores::call(core, [&] { handle = __local->fetch(request, response); });
+
+        if (handle != 0)
+        {
+            ctx->fetches[handle] = core;
+        }
+    }
+
+    void abort_fetch(const abort_fetch::request_parser_t& request,
+                     abort_fetch::response_builder_t* response,
+                     context* ctx)
+    {
+        uint32_t core = ctx->fetches[request.handle()];
+        ctx->fetches.erase(request.handle());
+
+        io::cores::call(core, [&] { __local->readers.erase(request.handle()); });
+    }
+
+    void snapshot(const snapshot::request_parser_t& request,
+                  snapshot::response_builder_t* response,
+                  context* ctx)
+    {
+        uint32_t core = owner(request.ushard());
+
+        if (ctx->snapshot_core != core)
+        {
+            release_snapshot(ctx);
+        }
+
+        ctx->snapshot_core = core;
+
+        io::cores::call(core, [&] { __local->snapshot(request.ushard(), ctx->id, response); });
+    }
+
+    void release_snapshot(context* ctx)
+    {
+        if (ctx->snapshot_core == invalid_core)
+        {
+            return;
+        }
+
+        uint64_t id = ctx->id;
+
+        io::cores::post(ctx->snapshot_core, [id] { __local->snapshots.erase(id); });
+        ctx->snapshot_core = invalid_core;
+    }
+
+    void print_stats()
+    {
+        logger::notice("capacity:    {}", storage::capacity());
+        logger::notice("used blocks: {}", storage::size());
+        logger::notice("free blocks: {}", storage::capacity() - storage::size());
+
+        print_fragmentation();
+        print_stacks();
+    }
+
+    impl(uint32_t merge_threads,
+         uint32_t ushards_num,
+         uint32_t max_slices,
+         uint64_t defragment_interval,
+         io::file wal_file)
+      : ushards_num(ushards_num)
+      , max_slices(max_slices)
+      , defragment_interval(defragment_interval)
+      , wal(std::move(wal_file))
+    {
+        __local = this;
+
+        for (uint32_t i = 0; i < ushards_num; i++)
+        {
+            if (owner(i) != io::cores::current())
+            {
+                continue;
+            }
+
+            ushards[i] = std::make_shared<tyrdbs::ushard>();
+            tier_locks[i] = std::make_shared<tier_locks_t>();
+        }
+
+        gt::create_thread(&impl::recover_thread, this);
+
+        for (uint32_t i = 0; i < merge_threads; i++)
+        {
+            gt::create_thread(gt::priority::background, &impl::merge_thread, this);
+        }
+    }
+
+private:
+    void wait_for_recovery()
+    {
+        while (recovered == false)
+        {
+            recovered_cond.wait();
+        }
+    }
+
+    void commit(const std::string_view& entries)
+    {
+        wait_for_recovery();
+
+        while (tyrdbs::slice::count() > max_slices)
+        {
+            gt::yield();
+        }
+
+        while (checkpoint_in_progress == true)
+        {
+            checkpoint_cond.wait();
+        }
+
+        commits_in_progress++;
+
+        writer w;
+
+        append(idx++, &w.record);
+        w.record.append(entries);
+
+        load(w.record, &w);
+
+        try
+        {
+            wal.commit(wal.append(w.record));
+            apply(&w);
+        }
+        catch (...)
+        {
+            end_commit();
+            throw;
+        }
+
+        end_commit();
+
+        if (wal.size() > max_wal_size)
+        {
+            checkpoint();
+        }
+    }
+
+    void end_commit()
+    {
+        if (--commits_in_progress == 0)
+        {
+            checkpoint_cond.signal_all();
+        }
+    }
+
+    uint64_t fetch(const fetch_data::request_parser_t& request,
+                   fetch_data::response_builder_t* response)
+    {
+        wait_for_recovery();
+
         if (request.has_handle() == false)
         {
-            auto&& ushard = ushards[request.ushard() % ushards.size()];
+            auto&& ushard = ushards[request.ushard() % ushards_num];
+
+            std::unique_ptr<tyrdbs::iterator> it;
+
+            if (request.min_key().compare(request.max_key()) == 0)
+            {
+                it = ushard->get(request.min_key());
+            }
+            else
+            {
+                it = ushard->range(request.min_key(), request.max_key());
+            }
 
-            auto&& it = ushard->range(request.min_key(), request.max_key());
             uint64_t handle = id(it);
 
-            if (it->next() == true)
+            if (it != nullptr && it->next() == true)
             {
                 reader r;
                 r.iterator = std::move(it);
@@ -213,6 +562,8 @@ struct impl : private disallow_copy
                 {
                     readers[handle] = std::move(r);
                     response->add_handle(handle);
+
+                    return handle;
                 }
             }
         }
@@ -228,30 +579,32 @@ struct impl : private disallow_copy
             else
             {
                 response->add_handle(handle);
+
+                return handle;
             }
         }
-    }
 
-    void abort_fetch(const abort_fetch::request_parser_t& request,
-                     abort_fetch::response_builder_t* response,
-                     context* ctx)
-    {
-        readers.erase(request.handle());
+        return 0;
     }
 
-    void snapshot(const snapshot::request_parser_t& request,
-                  snapshot::response_builder_t* response,
-                  context* ctx)
+    void snapshot(uint32_t ushard_id, uint64_t ctx_id, snapshot::response_builder_t* response)
     {
-        auto& ushard = ushards[request.ushard()];
-        ctx->snapshot = ushard->get_slices();
+        wait_for_recovery();
+
+        auto& ushard = ushards[ushard_id];
+
+        cb cb(ushard_id, this);
+        ushard->flush(&cb);
+
+        auto& slices_snapshot = snapshots[ctx_id];
+        slices_snapshot = ushard->get_slices();
 
         auto&& snapshot = tests::snapshot_builder(response->add_snapshot());
         snapshot.add_path(storage::path());
 
         auto&& slices = snapshot.add_slices();
 
-        for (auto&& c : ctx->snapshot)
+        for (auto&& c : slices_snapshot)
         {
             auto&& slice = slices.add_value();
             auto&& extents = slice.add_extents();
@@ -263,65 +616,69 @@ struct impl : private disallow_copy
         }
     }
 
-    void print_stats()
-    {
-        logger::notice("capacity:    {}", storage::capacity());
-        logger::notice("used blocks: {}", storage::size());
-        logger::notice("free blocks: {}", storage::capacity() - storage::size());
-    }
-
-    impl(uint32_t merge_threads,
-         uint32_t ushards_num,
-         uint32_t max_slices)
-      : max_slices(max_slices)
-    {
-        for (uint32_t i = 0; i < ushards_num; i++)
-        {
-            ushards[i] = std::make_shared<tyrdbs::ushard>();
-            tier_locks[i] = std::make_shared<tier_locks_t>();
-        }
-
-        for (uint32_t i = 0; i < merge_threads; i++)
-        {
-            gt::create_thread(&impl::merge_thread, this);
-        }
-    }
-
-private:
-    using slice_ptr =
-            std::shared_ptr<tyrdbs::slice_writer>;
+    using memtable_ptr =
+            std::shared_ptr<tyrdbs::memtable>;
 
-    using slices_t =
-            std::unordered_map<uint32_t, slice_ptr>;
+    using memtables_t =
+            std::unordered_map<uint32_t, memtable_ptr>;
 
     struct writer
     {
-        slices_t slices;
+        memtables_t memtables;
+        std::string record;
         uint64_t idx{0};
     };
 
+    using entries_t =
+            std::map<uint32_t, std::string>;
+
+    struct transaction
+    {
+        entries_t entries;
+    };
+
     struct reader
     {
         std::unique_ptr<tyrdbs::iterator> iterator;
         std::string_view value_part;
     };
 
-    using writers_t =
-            std::unordered_map<uint64_t, writer>;
+    using transactions_t =
+            std::unordered_map<uint64_t, transaction>;
 
     using readers_t =
             std::unordered_map<uint64_t, reader>;
 
+    using snapshots_t =
+            std::unordered_map<uint64_t, tyrdbs::ushard::slices_t>;
+
+    static constexpr uint64_t max_wal_size{64UL << 20};
+
+    uint32_t ushards_num{0};
     uint32_t max_slices{0};
+    uint64_t defragment_interval{0};
+
+    storage::wal wal;
 
     uint64_t idx{0};
 
-    writers_t writers;
+    uint64_t handles{0};
+    uint64_t contexts{0};
+
+    transactions_t transactions;
     readers_t readers;
+    snapshots_t snapshots;
 
     ring_queue<merge_request_t> merge_requests;
     gt::condition merge_cond;
 
+    bool recovered{false};
+    gt::condition recovered_cond;
+
+    uint32_t commits_in_progress{0};
+    bool checkpoint_in_progress{false};
+    gt::condition checkpoint_cond;
+
     using tier_locks_t =
             std::unordered_set<uint32_t>;
 
@@ -420,49 +777,140 @@ private:
         return (data_flags & 0x01) == 0x01;
     }
 
-    void update_entries(const message::parser* p, uint16_t off, writer* w)
+    template<typename T>
+    static void append(const T& data, std::string* record)
     {
-        tests::data_parser data(p, off);
+        record->append(reinterpret_cast<const char*>(&data), sizeof(T));
+    }
 
-        auto&& dbs = data.collections();
+    static void append(const std::string_view& data, std::string* record)
+    {
+        append(static_cast<uint16_t>(data.size()), record);
+        record->append(data.data(), data.size());
+    }
 
-        assert(dbs.next() == true);
-        auto&& db = dbs.value();
+    template<typename T>
+    static bool consume(std::string_view* data, T* value)
+    {
+        if (data->size() < sizeof(T))
+        {
+            return false;
+        }
 
-        auto&& entries = db.entries();
+        std::memcpy(value, data->data(), sizeof(T));
+        data->remove_prefix(sizeof(T));
 
-        while (entries.next() == true)
+        return true;
+    }
+
+    static bool consume(std::string_view* data, std::string_view* value)
+    {
+        uint16_t size = 0;
+
+        if (consume(data, &size) == false || data->size() < size)
         {
-            auto&& entry = entries.value();
+            return false;
+        }
+
+        *value = data->substr(0, size);
+        data->remove_prefix(size);
+
+        return true;
+    }
 
-            bool eor = entry.flags() & 0x01;
-            bool deleted = entry.flags() & 0x02;
+    void apply(writer* w)
+    {
+        for (auto&& memtable : w->memtables)
+        {
+            cb cb(memtable.first, this);
 
-            auto&& slice = w->slices[entry.ushard() % ushards.size()];
+            auto&& it = memtable.second->begin();
 
-            if (slice == nullptr)
+            if (it != nullptr)
             {
-                slice = std::make_unique<tyrdbs::slice_writer>();
+                ushards[memtable.first]->add(it.get(), &cb);
             }
+        }
+    }
+
+    static uint32_t owner(uint32_t ushard)
+    {
+        return ushard % io::cores::count();
+    }
 
-            slice->add(entry.key(), entry.value(), eor, deleted, w->idx);
+    bool owned(const writer& w) const
+    {
+        for (auto&& memtable : w.memtables)
+        {
+            if (ushards.find(memtable.first) == ushards.end())
+            {
+                return false;
+            }
         }
 
-        if ((data.flags() & 0x01) == 0x01)
+        return true;
+    }
+
+    static bool load(const std::string_view& record, writer* w)
+    {
+        std::string_view data(record);
+
+        if (consume(&data, &w->idx) == false)
+        {
+            return false;
+        }
+
+        while (data.size() != 0)
         {
-            auto jobs = gt::async::create_jobs();
+            uint32_t ushard = 0;
+            uint8_t flags = 0;
+
+            std::string_view key;
+            std::string_view value;
 
-            for (auto&& slice : w->slices)
+            if (consume(&data, &ushard) == false ||
+                consume(&data, &flags) == false ||
+                consume(&data, &key) == false ||
+                consume(&data, &value) == false)
             {
-                auto f = [slice]
-                {
-                    slice.second->flush();
-                };
+                return false;
+            }
+
+            auto&& memtable = w->memtables[ushard];
 
-                jobs.run(std::move(f));
+            if (memtable == nullptr)
+            {
+                memtable = std::make_shared<tyrdbs::memtable>();
             }
 
-            jobs.wait();
+            memtable->add(key, value, flags & 0x01, flags & 0x02, w->idx);
+        }
+
+        return true;
+    }
+
+    void update_entries(const message::parser* p, uint16_t off, transaction* t)
+    {
+        tests::data_parser data(p, off);
+
+        auto&& dbs = data.collections();
+
+        assert(dbs.next() == true);
+        auto&& db = dbs.value();
+
+        auto&& entries = db.entries();
+
+        while (entries.next() == true)
+        {
+            auto&& entry = entries.value();
+
+            uint32_t ushard = entry.ushard() % ushards_num;
+            auto&& entries = t->entries[owner(ushard)];
+
+            append(ushard, &entries);
+            append(static_cast<uint8_t>(entry.flags() & 0x03), &entries);
+            append(entry.key(), &entries);
+            append(entry.value(), &entries);
         }
     }
 };
@@ -477,6 +925,116 @@ using server_t =
         net::rpc_server<8192, db_server_service_t>;
 
 
+std::string core_path(const std::string_view& path, uint32_t core)
+{
+    if (io::cores::count() == 1)
+    {
+        return std::string(path);
+    }
+
+    return fmt::format("{}.{}", path, core);
+}
+
+void run_core(cmd_line* cmd, uint32_t core)
+{
+    gt::set_guarded_stacks(cmd->flag("guarded-stacks"));
+    gt::set_stack_sample_rate(cmd->get<uint32_t>("stack-sample-rate"));
+
+    io::initialize(4096, cmd->flag("sqpoll"));
+    io::file::initialize(cmd->get<uint32_t>("storage-queue-depth"));
+
+    if (cmd->flag("storage-sqpoll") == true || cmd->flag("storage-iopoll") == true)
+    {
+        io::initialize_storage(cmd->get<uint32_t>("storage-queue-depth"),
+                               cmd->flag("storage-sqpoll"),
+                               cmd->flag("storage-iopoll"));
+    }
+    io::channel::initialize(cmd->get<uint32_t>("network-queue-depth"));
+
+    if (cmd->get<uint32_t>("block-cache-shard-bits") != 0)
+    {
+        tyrdbs::cache::initialize_shared(cmd->get<uint64_t>("block-cache-size") << 20,
+                                         cmd->get<uint32_t>("block-cache-shard-bits"));
+    }
+    else
+    {
+        tyrdbs::cache::initialize(cmd->get<uint64_t>("block-cache-size") << 20);
+    }
+
+    tyrdbs::slice_writer::set_bloom_filter_bits(cmd->get<uint32_t>("bloom-filter-bits"));
+
+    tyrdbs::ushard::set_memtable_size(cmd->get<uint64_t>("memtable-size"));
+    tyrdbs::slice::set_readahead_window(cmd->get<uint32_t>("readahead-window"));
+    storage::disk_writer::set_queue_depth(cmd->get<uint32_t>("flush-queue-depth"));
+    storage::disk::set_discard_rate(cmd->get<uint64_t>("discard-rate") << 20);
+    storage::defragmenter::set_threshold(cmd->get<uint32_t>("defragment-threshold"));
+    storage::defragmenter::set_rate(cmd->get<uint64_t>("defragment-rate") << 20);
+
+    if (cmd->flag("plain-keys") == true)
+    {
+        tyrdbs::slice_writer::set_key_encoding(tyrdbs::node::key_encoding::plain);
+    }
+
+    std::vector<io::file> storage_files;
+    std::string_view storage_paths = cmd->get<std::string_view>("storage-file");
+
+    while (storage_paths.empty() == false)
+    {
+        auto storage_path = storage_paths.substr(0, storage_paths.find(','));
+        storage_paths.remove_prefix(std::min(storage_path.size() + 1, storage_paths.size()));
+
+        if (cmd->flag("recover") == true)
+        {
+            storage_files.push_back(io::file::open(io::file::access::read_write,
+                                                   core_path(storage_path, core)));
+        }
+        else
+        {
+            storage_files.push_back(io::file::create(core_path(storage_path, core)));
+        }
+    }
+
+    io::file wal_file;
+
+    if (cmd->flag("recover") == true)
+    {
+        wal_file = io::file::open(io::file::access::read_write,
+                                  core_path(cmd->get<std::string_view>("wal-file"), core));
+    }
+    else
+    {
+        wal_file = io::file::create(core_path(cmd->get<std::string_view>("wal-file"), core));
+    }
+
+    storage::initialize(std::move(storage_files),
+                        cmd->get<uint32_t>("cache-bits"),
+                        cmd->get<uint32_t>("write-cache-bits"),
+                        cmd->flag("preallocate-space"),
+                        cmd->flag("direct-io"),
+                        cmd->flag("recover"));
+
+    module::impl impl(cmd->get<uint32_t>("merge-threads"),
+                      cmd->get<uint32_t>("ushards"),
+                      cmd->get<uint32_t>("max-slices"),
+                      cmd->get<uint64_t>("defragment-interval"),
+                      std::move(wal_file));
+
+    db_server_service_t srv(&impl);
+
+    std::unique_ptr<server_t> s;
+    auto uri = cmd->get<std::string_view>("uri");
+
+    if (core == 0 || uri.substr(0, 6) == "tcp://")
+    {
+        s = std::make_unique<server_t>(io::uri::listen(uri),
+                                       &srv,
+                                       cmd->get<uint64_t>("idle-timeout"));
+    }
+
+    gt::run();
+}
+
+
 int main(int argc, const char* argv[])
 {
     cmd_line cmd(argv[0], "Network server demo.", nullptr);
@@ -502,6 +1060,14 @@ int main(int argc, const char* argv[])
                   "0",
                   {"cpu index to run the program on (default is 0)"});
 
+    cmd.add_param("cores",
+                  nullptr,
+                  "cores",
+                  "num",
+                  "1",
+                  {"number of cores to run on, starting at --cpu; ushards",
+                   "are partitioned across them (default is 1)"});
+
     cmd.add_param("merge-threads",
                   nullptr,
                   "merge-threads",
@@ -537,24 +1103,150 @@ int main(int argc, const char* argv[])
                   "14",
                   {"write cache size expressed as 2^bits (default is 14)"});
 
-    cmd.add_param("block-cache-bits",
+    cmd.add_param("block-cache-size",
+                  nullptr,
+                  "block-cache-size",
+                  "MB",
+                  "32",
+                  {"block cache size in megabytes (default is 32)"});
+
+    cmd.add_param("block-cache-shard-bits",
                   nullptr,
-                  "block-cache-bits",
+                  "block-cache-shard-bits",
                   "bits",
-                  "12",
-                  {"block cache size expressed as 2^bits (default is 12)"});
+                  "0",
+                  {"share the block cache across threads in 2^bits shards, 0 for a per-thread cache (default is 0)"});
+
+    cmd.add_param("bloom-filter-bits",
+                  nullptr,
+                  "bloom-filter-bits",
+                  "bits",
+                  "10",
+                  {"bloom filter bits per key, 0 to disable (default is 10)"});
+
+    cmd.add_param("readahead-window",
+                  nullptr,
+                  "readahead-window",
+                  "leaves",
+                  "8",
+                  {"leaves to read ahead on sequential scans, 0 to disable (default is 8)"});
+
+    cmd.add_param("flush-queue-depth",
+                  nullptr,
+                  "flush-queue-depth",
+                  "writes",
+                  "8",
+                  {"maximum number of in-flight page flush writes per",
+                   "storage file (default is 8)"});
+
+    cmd.add_param("discard-rate",
+                  nullptr,
+                  "discard-rate",
+                  "MB/s",
+                  "64",
+                  {"rate at which freed extents on block devices are",
+                   "discarded, 0 to disable (default is 64)"});
+
+    cmd.add_param("defragment-interval",
+                  nullptr,
+                  "defragment-interval",
+                  "msec",
+                  "0",
+                  {"run the defragmenter in the background at this",
+                   "interval, 0 to disable (default is 0)"});
+
+    cmd.add_param("defragment-threshold",
+                  nullptr,
+                  "defragment-threshold",
+                  "extents",
+                  "8",
+                  {"relocate files with more than this many extents",
+                   "above their stripe count (default is 8)"});
+
+    cmd.add_param("defragment-rate",
+                  nullptr,
+                  "defragment-rate",
+                  "MB/s",
+                  "16",
+                  {"rate at which the defragmenter copies data,",
+                   "0 for unlimited (default is 16)"});
+
+    cmd.add_param("memtable-size",
+                  nullptr,
+                  "memtable-size",
+                  "bytes",
+                  "4194304",
+                  {"ushard memtable size before it is flushed (default is 4194304)"});
+
+    cmd.add_flag("plain-keys",
+                 nullptr,
+                 "plain-keys",
+                 {"store keys without prefix compression"});
 
     cmd.add_flag("preallocate-space",
                  nullptr,
                  "preallocate-space",
                  {"preallocate space on disk"});
 
+    cmd.add_flag("direct-io",
+                 nullptr,
+                 "direct-io",
+                 {"bypass the OS page cache when accessing the storage file"});
+
+    cmd.add_flag("sqpoll",
+                 nullptr,
+                 "sqpoll",
+                 {"use kernel-side submission polling for the network ring"});
+
+    cmd.add_flag("storage-sqpoll",
+                 nullptr,
+                 "storage-sqpoll",
+                 {"use a separate storage ring with kernel-side submission polling"});
+
+    cmd.add_flag("storage-iopoll",
+                 nullptr,
+                 "storage-iopoll",
+                 {"use a separate storage ring with completion polling;",
+                  "requires --direct-io"});
+
+    cmd.add_flag("recover",
+                 nullptr,
+                 "recover",
+                 {"recover ushards from an existing storage file"});
+
+    cmd.add_flag("guarded-stacks",
+                 nullptr,
+                 "guarded-stacks",
+                 {"allocate thread stacks with mmap and a guard page"});
+
+    cmd.add_param("stack-sample-rate",
+                  nullptr,
+                  "stack-sample-rate",
+                  "threads",
+                  "0",
+                  {"measure stack usage of every n-th thread, 0 to disable (default is 0)"});
+
+    cmd.add_param("idle-timeout",
+                  nullptr,
+                  "idle-timeout",
+                  "msec",
+                  "0",
+                  {"disconnect clients idle for this long, 0 to disable (default is 0)"});
+
     cmd.add_param("storage-file",
                   nullptr,
                   "storage-file",
                   "file",
                   "storage.dat",
-                  {"storage file to use (default storage.dat)"});
+                  {"storage file to use, or a comma separated list of",
+                   "files to stripe data across (default storage.dat)"});
+
+    cmd.add_param("wal-file",
+                  nullptr,
+                  "wal-file",
+                  "file",
+                  "storage.wal",
+                  {"write-ahead log file to use (default storage.wal)"});
 
     cmd.add_param("uri",
                   "<uri>",
@@ -562,32 +1254,21 @@ int main(int argc, const char* argv[])
 
     cmd.parse(argc, argv);
 
-    set_cpu(cmd.get<uint32_t>("cpu"));
+    if (cmd.flag("storage-iopoll") == true && cmd.flag("direct-io") == false)
+    {
+        throw cmd_line::error("--storage-iopoll requires --direct-io");
+    }
 
     assert(crc32c_initialize() == true);
 
-    gt::initialize();
-    gt::async::initialize();
-    io::initialize(4096);
-    io::file::initialize(cmd.get<uint32_t>("storage-queue-depth"));
-    io::channel::initialize(cmd.get<uint32_t>("network-queue-depth"));
-
-    tyrdbs::cache::initialize(cmd.get<uint32_t>("block-cache-bits"));
-
-    storage::initialize(io::file::create(cmd.get<std::string_view>("storage-file")),
-                        cmd.get<uint32_t>("cache-bits"),
-                        cmd.get<uint32_t>("write-cache-bits"),
-                        cmd.flag("preallocate-space"));
+    io::cores::cpus_t cpus;
 
-    module::impl impl(cmd.get<uint32_t>("merge-threads"),
-                      cmd.get<uint32_t>("ushards"),
-                      cmd.get<uint32_t>("max-slices"));
-
-    db_server_service_t srv(&impl);
-
-    server_t s(io::uri::listen(cmd.get<std::string_view>("uri")), &srv);
+    for (uint32_t i = 0; i < cmd.get<uint32_t>("cores"); i++)
+    {
+        cpus.push_back(cmd.get<uint32_t>("cpu") + i);
+    }
 
-    gt::run();
+    io::cores::run(cpus, std::bind(&run_core, &cmd, std::placeholders::_1));
 
     return 0;
 }
@@ -0,0 +1,72 @@
+#include <tyrdbs/memtable.h>
+
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest/doctest.h>
+
+#include <fmt/format.h>
+
+#include <map>
+#include <string>
+
+
+using namespace tyrtech;
+
+
+std::string make_value(uint32_t i, uint32_t size)
+{
+    std::string value(size, '\0');
+
+    for (uint32_t j = 0; j < size; j++)
+    {
+        value[j] = static_cast<char>('a' + (i + j) % 26);
+    }
+
+    return value;
+}
+
+
+TEST_CASE("large_values")
+{
+    auto memtable = std::make_shared<tyrdbs::memtable>();
+
+    std::map<std::string, std::string> data;
+
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        uint32_t size = (i % 3 == 0) ? 20000 + (i % 7) * 5000 : 100 + (i % 50);
+
+        auto key = fmt::format("key{:06}", i);
+        auto value = make_value(i, size);
+
+        memtable->add(key, value, true, false, i + 1);
+        data[key] = value;
+    }
+
+    CHECK(memtable->key_count() == data.size());
+
+    auto it = memtable->begin();
+    REQUIRE(it != nullptr);
+
+    auto expected = data.begin();
+    std::string value;
+
+    while (it->next() == true)
+    {
+        value.append(it->value().data(), it->value().size());
+
+        if (it->eor() == false)
+        {
+            continue;
+        }
+
+        REQUIRE(expected != data.end());
+
+        CHECK(it->key() == expected->first);
+        CHECK(value == expected->second);
+
+        value.clear();
+        ++expected;
+    }
+
+    CHECK(expected == data.end());
+}
@@ -9,6 +9,7 @@
 #include <tests/stats.h>
 
 #include <random>
+#include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/ioctl.h>
 
@@ -71,6 +72,36 @@ void read_test(operation op,
     }
 }
 
+uint32_t cached_pages(io::file* f, uint32_t pages)
+{
+    uint64_t size = static_cast<uint64_t>(pages) << 12;
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, f->fd(), 0);
+
+    if (data == MAP_FAILED)
+    {
+        throw runtime_error("{}: {}", f->path(), system_error().message);
+    }
+
+    std::vector<unsigned char> residency(pages);
+
+    if (mincore(data, size, residency.data()) == -1)
+    {
+        throw runtime_error("{}: {}", f->path(), system_error().message);
+    }
+
+    munmap(data, size);
+
+    uint32_t count = 0;
+
+    for (auto&& page : residency)
+    {
+        count += page & 1;
+    }
+
+    return count;
+}
+
 int main(int argc, const char* argv[])
 {
     cmd_line cmd(argv[0], "Measure I/O subsystem read latencies.", nullptr);
@@ -121,6 +152,22 @@ int main(int argc, const char* argv[])
                   "10000",
                   {"number of iterations per thread to do (default is 10000)"});
 
+    cmd.add_flag("direct-io",
+                 nullptr,
+                 "direct-io",
+                 {"open the file with O_DIRECT, bypassing the OS page cache"});
+
+    cmd.add_flag("sqpoll",
+                 nullptr,
+                 "sqpoll",
+                 {"read through a separate ring with kernel-side submission polling"});
+
+    cmd.add_flag("iopoll",
+                 nullptr,
+                 "iopoll",
+                 {"read through a separate ring with completion polling;",
+                  "requires --direct-io"});
+
     cmd.add_param("file",
                   "<file>",
                   {"file to read from; can be a block device"});
@@ -154,7 +201,28 @@ int main(int argc, const char* argv[])
     io::initialize(4096);
     io::file::initialize(cmd.get<uint32_t>("storage-queue-depth"));
 
+    bool separate_ring = cmd.flag("sqpoll") == true || cmd.flag("iopoll") == true;
+
+    if (separate_ring == true)
+    {
+        if (cmd.flag("iopoll") == true && cmd.flag("direct-io") == false)
+        {
+            throw cmd_line::error("--iopoll requires --direct-io");
+        }
+
+        io::initialize_storage(cmd.get<uint32_t>("storage-queue-depth"),
+                               cmd.flag("sqpoll"),
+                               cmd.flag("iopoll"));
+    }
+
     auto f = io::file::open(io::file::access::read, cmd.get<std::string_view>("file"));
+    f.set_direct_io(cmd.flag("direct-io"));
+
+    if (separate_ring == true && io::register_file(f.fd()) == -1)
+    {
+        throw runtime_error("{}: {}", f.path(), system_error().message);
+    }
+
     auto stat = f.stat();
 
     uint32_t pages = 0;
@@ -177,6 +245,8 @@ int main(int argc, const char* argv[])
 
     assert(pages != 0);
 
+    uint32_t cached_pages_before = cached_pages(&f, pages);
+
     std::vector<tests::stats> s;
 
     for (uint32_t i = 0; i < cmd.get<uint32_t>("threads"); i++)
@@ -201,7 +271,11 @@ int main(int argc, const char* argv[])
 
     auto t2 = clock::now();
 
+    uint32_t cached_pages_after = cached_pages(&f, pages);
+
     logger::notice("pages: {}", pages);
+    logger::notice("direct io: {}", cmd.flag("direct-io"));
+    logger::notice("sqpoll: {}, iopoll: {}", cmd.flag("sqpoll"), cmd.flag("iopoll"));
     logger::notice("");
 
     for (uint32_t i = 0; i < s.size(); i++)
@@ -218,6 +292,9 @@ int main(int argc, const char* argv[])
 
     logger::notice("avg iops: {:.2f}", iops);
     logger::notice("avg read: {:.2f} MiB/s", iops / 256);
+    logger::notice("");
+    logger::notice("page cache before: {:.2f} MiB", cached_pages_before / 256.);
+    logger::notice("page cache after: {:.2f} MiB", cached_pages_after / 256.);
 
     return 0;
 }
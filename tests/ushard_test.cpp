@@ -16,12 +16,23 @@ using namespace tyrtech;
 
 struct test_cb : public tyrdbs::ushard::meta_callback
 {
+    uint32_t owner{0};
+
     void add(const tyrtech::tyrdbs::ushard::slice_ptr& slice) override
     {
+        storage::add_file(owner, slice->descriptor());
+        storage::commit();
     }
 
     void remove(const tyrtech::tyrdbs::ushard::slices_t& slices) override
     {
+        for (auto&& slice : slices)
+        {
+            storage::remove_file(slice->descriptor().cache_id);
+        }
+
+        storage::commit();
+
         for (auto&& slice : slices)
         {
             slice->unlink();
@@ -55,6 +66,7 @@ struct thread_data
 
     tests::stats vs_stats;
     tests::stats vr_stats;
+    tests::stats vg_stats;
 
     thread_data(uint32_t thread_id)
       : thread_id(thread_id)
@@ -64,6 +76,9 @@ struct thread_data
 
 
 std::string string_storage;
+storage::manifest::files_t recovered_files;
+
+bool use_memtable{false};
 
 
 using string_t =
@@ -79,8 +94,39 @@ using data_sets_t =
         std::vector<data_set_t>;
 
 
+void insert_memtable(const data_set_t& data, test_cb* cb)
+{
+    auto m = std::make_shared<tyrdbs::memtable>();
+
+    auto t1 = clock::now();
+
+    for (auto&& it : data)
+    {
+        std::string_view key(string_storage.data() + it.first.first, it.first.second);
+        m->add(key, key, true, false, it.second);
+    }
+
+    cb->ushard->add(m->begin().get(), cb);
+
+    auto t2 = clock::now();
+
+    uint64_t duration = t2 - t1;
+
+    logger::notice("buffered {} keys in {:.6f} s, {:.2f} keys/s",
+                   data.size(),
+                   duration / 1000000000.,
+                   data.size() * 1000000000. / duration);
+}
+
+
 void insert(const data_set_t& data, test_cb* cb)
 {
+    if (use_memtable == true)
+    {
+        insert_memtable(data, cb);
+        return;
+    }
+
     tyrdbs::slice_writer w;
 
     auto t1 = clock::now();
@@ -206,6 +252,55 @@ void verify_range(const data_set_t& data, tyrdbs::ushard* ushard, tests::stats*
     }
 }
 
+void verify_get(const data_set_t& data, tyrdbs::ushard* ushard, tests::stats* s)
+{
+    auto&& data_it = data.begin();
+
+    std::string value;
+
+    while (data_it != data.end())
+    {
+        std::string_view key(string_storage.data() + data_it->first.first,
+                             data_it->first.second);
+
+        std::unique_ptr<tyrdbs::iterator> db_it;
+
+        {
+            auto sw = s->stopwatch();
+            db_it = ushard->get(key);
+        }
+
+        assert(db_it != nullptr);
+        assert(db_it->next() == true);
+
+        while (true)
+        {
+            assert(db_it->key().compare(key) == 0);
+            assert(db_it->deleted() == false);
+            assert(db_it->idx() == data_it->second);
+
+            auto&& value_part = db_it->value();
+            value.append(value_part.data(), value_part.size());
+
+            if (db_it->eor() == true)
+            {
+                break;
+            }
+
+            assert(db_it->next() == true);
+        }
+
+        assert(db_it->next() == false);
+        assert(key.compare(value) == 0);
+
+        value.clear();
+
+        ++data_it;
+
+        gt::yield();
+    }
+}
+
 void merge_thread(test_cb* cb)
 {
     while (true)
@@ -266,8 +361,37 @@ void merge_thread(test_cb* cb)
 }
 
 
+void load(const storage::manifest::files_t& files, test_cb* cb)
+{
+    auto t1 = clock::now();
+
+    uint32_t slices = 0;
+
+    for (auto&& it : files)
+    {
+        if (it.second.owner != cb->owner)
+        {
+            continue;
+        }
+
+        auto descriptor = it.second.descriptor;
+        auto reader = storage::create_reader(std::move(descriptor));
+
+        cb->ushard->load(std::make_shared<tyrdbs::slice>(std::move(reader)), cb);
+
+        slices++;
+    }
+
+    auto t2 = clock::now();
+
+    logger::notice("recovered {} slices in {:.6f} s",
+                   slices,
+                   (t2 - t1) / 1000000000.);
+}
+
 void test(const data_sets_t* data,
           const data_set_t* test_data,
+          const storage::manifest::files_t* files,
           thread_data* t,
           bool compact)
 {
@@ -275,13 +399,21 @@ void test(const data_sets_t* data,
 
     test_cb cb;
 
+    cb.owner = t->thread_id;
     cb.ushard = std::make_shared<tyrdbs::ushard>();
 
-    gt::create_thread(merge_thread, &cb);
+    gt::create_thread(gt::priority::background, merge_thread, &cb);
 
-    for (auto&& set : *data)
+    if (files != nullptr)
     {
-        insert(set, &cb);
+        load(*files, &cb);
+    }
+    else
+    {
+        for (auto&& set : *data)
+        {
+            insert(set, &cb);
+        }
     }
 
     cb.compact = compact;
@@ -296,6 +428,9 @@ void test(const data_sets_t* data,
 
     verify_sequential(*test_data, cb.ushard.get(), &t->vs_stats);
     verify_range(*test_data, cb.ushard.get(), &t->vr_stats);
+    verify_get(*test_data, cb.ushard.get(), &t->vg_stats);
+
+    cb.ushard->flush(&cb);
 
     auto t2 = clock::now();
 
@@ -372,6 +507,74 @@ data_set_t load_test_data(const std::string_view& path)
     return set;
 }
 
+void start(const data_sets_t* data,
+           const data_set_t* test_data,
+           std::vector<thread_data>* td,
+           bool compact,
+           bool recover,
+           uint64_t defragment_interval)
+{
+    recovered_files = storage::recover();
+
+    if (defragment_interval != 0)
+    {
+        storage::start_defragmenter(defragment_interval);
+    }
+
+    for (auto&& t : *td)
+    {
+        gt::create_thread(test,
+                          data,
+                          test_data,
+                          recover == true ? &recovered_files : nullptr,
+                          &t,
+                          compact);
+    }
+}
+
+void print_histogram(const char* name, const storage::fragmentation_stats::histogram_t& histogram)
+{
+    logger::notice("{}:", name);
+
+    for (uint32_t i = 0; i < histogram.size(); i++)
+    {
+        if (histogram[i] != 0)
+        {
+            logger::notice("  {:>8}-{:<8} {}", 1U << i, (2U << i) - 1, histogram[i]);
+        }
+    }
+}
+
+void print_fragmentation()
+{
+    auto stats = storage::fragmentation();
+
+    print_histogram("free ranges [pages]", stats.free_ranges);
+    print_histogram("extents per file", stats.file_extents);
+
+    logger::notice("relocated:   {} files, {} pages", stats.relocated_files, stats.relocated_pages);
+}
+
+void print_stacks()
+{
+    auto stats = gt::stacks_stats();
+
+    for (uint32_t i = 0; i < stats.size(); i++)
+    {
+        if (stats[i].contexts == 0)
+        {
+            continue;
+        }
+
+        logger::notice("stacks {:>2} KB: {} contexts, {} sampled, high water mark {} bytes, {} KB reserved",
+                       static_cast<uint32_t>(gt::stack_sizes[i]) >> 10,
+                       stats[i].contexts,
+                       stats[i].sampled,
+                       stats[i].high_water_mark,
+                       stats[i].reserved >> 10);
+    }
+}
+
 void report(thread_data* t)
 {
     logger::notice("");
@@ -386,6 +589,10 @@ void report(thread_data* t)
     logger::notice("");
     logger::notice("random read [ns]:");
     t->vr_stats.report();
+
+    logger::notice("");
+    logger::notice("point get [ns]:");
+    t->vg_stats.report();
 }
 
 int main(int argc, const char* argv[])
@@ -427,23 +634,122 @@ int main(int argc, const char* argv[])
                   "14",
                   {"write cache size expressed as 2^bits (default is 14)"});
 
-    cmd.add_param("block-cache-bits",
+    cmd.add_param("block-cache-size",
+                  nullptr,
+                  "block-cache-size",
+                  "MB",
+                  "32",
+                  {"block cache size in megabytes (default is 32)"});
+
+    cmd.add_param("bloom-filter-bits",
                   nullptr,
-                  "block-cache-bits",
+                  "bloom-filter-bits",
                   "bits",
-                  "12",
-                  {"block cache size expressed as 2^bits (default is 12)"});
+                  "10",
+                  {"bloom filter bits per key, 0 to disable (default is 10)"});
+
+    cmd.add_flag("plain-keys",
+                 nullptr,
+                 "plain-keys",
+                 {"store keys without prefix compression"});
 
     cmd.add_flag("preallocate-space",
                  nullptr,
                  "preallocate-space",
                  {"preallocate space on disk"});
 
+    cmd.add_flag("direct-io",
+                 nullptr,
+                 "direct-io",
+                 {"bypass the OS page cache when accessing the storage file"});
+
+    cmd.add_flag("storage-sqpoll",
+                 nullptr,
+                 "storage-sqpoll",
+                 {"use a separate storage ring with kernel-side submission polling"});
+
+    cmd.add_flag("storage-iopoll",
+                 nullptr,
+                 "storage-iopoll",
+                 {"use a separate storage ring with completion polling;",
+                  "requires --direct-io"});
+
+    cmd.add_param("readahead-window",
+                  nullptr,
+                  "readahead-window",
+                  "leaves",
+                  "8",
+                  {"leaves to read ahead on sequential scans, 0 to disable (default is 8)"});
+
+    cmd.add_param("flush-queue-depth",
+                  nullptr,
+                  "flush-queue-depth",
+                  "writes",
+                  "8",
+                  {"maximum number of in-flight page flush writes per",
+                   "storage file (default is 8)"});
+
+    cmd.add_param("discard-rate",
+                  nullptr,
+                  "discard-rate",
+                  "MB/s",
+                  "64",
+                  {"rate at which freed extents on block devices are",
+                   "discarded, 0 to disable (default is 64)"});
+
+    cmd.add_param("defragment-interval",
+                  nullptr,
+                  "defragment-interval",
+                  "msec",
+                  "0",
+                  {"run the defragmenter in the background at this",
+                   "interval, 0 to disable (default is 0)"});
+
+    cmd.add_param("defragment-threshold",
+                  nullptr,
+                  "defragment-threshold",
+                  "extents",
+                  "8",
+                  {"relocate files with more than this many extents",
+                   "above their stripe count (default is 8)"});
+
+    cmd.add_param("defragment-rate",
+                  nullptr,
+                  "defragment-rate",
+                  "MB/s",
+                  "16",
+                  {"rate at which the defragmenter copies data,",
+                   "0 for unlimited (default is 16)"});
+
+    cmd.add_param("memtable-size",
+                  nullptr,
+                  "memtable-size",
+                  "bytes",
+                  "0",
+                  {"insert through memtables of this size, 0 to disable (default is 0)"});
+
     cmd.add_flag("compact",
                  nullptr,
                  "compact",
                  {"compact ushard before reading"});
 
+    cmd.add_flag("recover",
+                 nullptr,
+                 "recover",
+                 {"recover ushards from an existing storage file instead of inserting"});
+
+    cmd.add_flag("guarded-stacks",
+                 nullptr,
+                 "guarded-stacks",
+                 {"allocate thread stacks with mmap and a guard page"});
+
+    cmd.add_param("stack-sample-rate",
+                  nullptr,
+                  "stack-sample-rate",
+                  "threads",
+                  "0",
+                  {"measure stack usage of every n-th thread, 0 to disable (default is 0)"});
+
     cmd.add_param("input-data",
                   nullptr,
                   "input-data",
@@ -463,7 +769,8 @@ int main(int argc, const char* argv[])
                   "storage-file",
                   "file",
                   "storage.dat",
-                  {"storage file to use (default storage.dat)"});
+                  {"storage file to use, or a comma separated list of",
+                   "files to stripe data across (default storage.dat)"});
 
     cmd.parse(argc, argv);
 
@@ -476,15 +783,68 @@ int main(int argc, const char* argv[])
 
     gt::initialize();
     gt::async::initialize();
+
+    gt::set_guarded_stacks(cmd.flag("guarded-stacks"));
+    gt::set_stack_sample_rate(cmd.get<uint32_t>("stack-sample-rate"));
     io::initialize(4096);
     io::file::initialize(cmd.get<uint32_t>("storage-queue-depth"));
 
-    tyrdbs::cache::initialize(cmd.get<uint32_t>("block-cache-bits"));
+    if (cmd.flag("storage-sqpoll") == true || cmd.flag("storage-iopoll") == true)
+    {
+        if (cmd.flag("storage-iopoll") == true && cmd.flag("direct-io") == false)
+        {
+            throw cmd_line::error("--storage-iopoll requires --direct-io");
+        }
+
+        io::initialize_storage(cmd.get<uint32_t>("storage-queue-depth"),
+                               cmd.flag("storage-sqpoll"),
+                               cmd.flag("storage-iopoll"));
+    }
+
+    tyrdbs::cache::initialize(cmd.get<uint64_t>("block-cache-size") << 20);
+    tyrdbs::slice_writer::set_bloom_filter_bits(cmd.get<uint32_t>("bloom-filter-bits"));
+
+    if (cmd.flag("plain-keys") == true)
+    {
+        tyrdbs::slice_writer::set_key_encoding(tyrdbs::node::key_encoding::plain);
+    }
+
+    tyrdbs::slice::set_readahead_window(cmd.get<uint32_t>("readahead-window"));
+    storage::disk_writer::set_queue_depth(cmd.get<uint32_t>("flush-queue-depth"));
+    storage::disk::set_discard_rate(cmd.get<uint64_t>("discard-rate") << 20);
+    storage::defragmenter::set_threshold(cmd.get<uint32_t>("defragment-threshold"));
+    storage::defragmenter::set_rate(cmd.get<uint64_t>("defragment-rate") << 20);
+
+    if (cmd.get<uint64_t>("memtable-size") != 0)
+    {
+        tyrdbs::ushard::set_memtable_size(cmd.get<uint64_t>("memtable-size"));
+        use_memtable = true;
+    }
+
+    std::vector<io::file> storage_files;
+    std::string_view storage_paths = cmd.get<std::string_view>("storage-file");
+
+    while (storage_paths.empty() == false)
+    {
+        auto storage_path = storage_paths.substr(0, storage_paths.find(','));
+        storage_paths.remove_prefix(std::min(storage_path.size() + 1, storage_paths.size()));
+
+        if (cmd.flag("recover") == true)
+        {
+            storage_files.push_back(io::file::open(io::file::access::read_write, storage_path));
+        }
+        else
+        {
+            storage_files.push_back(io::file::create(storage_path));
+        }
+    }
 
-    storage::initialize(io::file::create(cmd.get<std::string_view>("storage-file")),
+    storage::initialize(std::move(storage_files),
                         cmd.get<uint32_t>("cache-bits"),
                         cmd.get<uint32_t>("write-cache-bits"),
-                        cmd.flag("preallocate-space"));
+                        cmd.flag("preallocate-space"),
+                        cmd.flag("direct-io"),
+                        cmd.flag("recover"));
 
     std::vector<thread_data> td;
 
@@ -493,10 +853,13 @@ int main(int argc, const char* argv[])
         td.push_back(thread_data(i));
     }
 
-    for (uint32_t i = 0; i < td.size(); i++)
-    {
-        gt::create_thread(test, &data, &test_data, &td[i], cmd.flag("compact"));
-    }
+    gt::create_thread(start,
+                      &data,
+                      &test_data,
+                      &td,
+                      cmd.flag("compact"),
+                      cmd.flag("recover"),
+                      cmd.get<uint64_t>("defragment-interval"));
 
     auto t1 = clock::now();
 
@@ -521,5 +884,11 @@ int main(int argc, const char* argv[])
     logger::notice("used blocks: {}", size);
     logger::notice("free blocks: {}", capacity - size);
 
+    logger::notice("");
+    print_fragmentation();
+
+    logger::notice("");
+    print_stacks();
+
     return 0;
 }
@@ -1,7 +1,10 @@
 #include <common/allocator.h>
 #include <common/branch_prediction.h>
+#include <common/exception.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 
 namespace tyrtech {
@@ -9,25 +12,42 @@ namespace tyrtech {
 
 uint32_t allocator::allocate(uint32_t size)
 {
-    auto it = m_free_set.lower_bound(static_cast<uint64_t>(size) << 32);
+    uint32_t slot = find_suitable(size);
 
-    if (it == m_free_set.end())
+    if (slot == invalid_slot)
+    {
+        uint32_t fl;
+        uint32_t sl;
+
+        mapping(size, &fl, &sl);
+
+        for (uint32_t s = m_heads[fl][sl]; s != invalid_slot; s = m_ranges[s].next)
+        {
+            if (m_ranges[s].size >= size)
+            {
+                slot = s;
+                break;
+            }
+        }
+    }
+
+    if (slot == invalid_slot)
     {
         return static_cast<uint32_t>(-1);
     }
 
-    uint32_t idx = *it & 0xffffffffU;
-    uint32_t available_size = *it >> 32;
+    uint32_t idx = m_ranges[slot].idx;
+    uint32_t available_size = m_ranges[slot].size;
 
-    m_free_set.erase(it);
-    m_idx_set.erase((static_cast<uint64_t>(idx) << 32) | available_size);
+    remove_range(slot);
 
     if (available_size > size)
     {
-        m_free_set.insert((static_cast<uint64_t>(available_size - size) << 32) | (idx + size));
-        m_idx_set.insert((static_cast<uint64_t>(idx + size) << 32) | (available_size - size));
+        insert_range(idx + size, available_size - size);
     }
 
+    set_free(idx, size, false);
+
     m_size += size;
 
     return idx;
@@ -35,90 +55,637 @@ uint32_t allocator::allocate(uint32_t size)
 
 void allocator::free(uint32_t idx, uint32_t size)
 {
+    if (size == 0)
+    {
+        return;
+    }
+
     assert(likely(m_size >= size));
     m_size -= size;
 
-    if (m_idx_set.size() == 0)
+    assert(likely(is_free(idx, size) == false));
+    set_free(idx, size, true);
+
+    uint32_t start = idx;
+    uint32_t end = idx + size;
+
+    if (uint32_t prev = m_ends.find(start); prev != invalid_slot)
+    {
+        start = m_ranges[prev].idx;
+        remove_range(prev);
+    }
+
+    if (uint32_t next = m_starts.find(end); next != invalid_slot)
+    {
+        end += m_ranges[next].size;
+        remove_range(next);
+    }
+
+    insert_range(start, end - start);
+}
+
+bool allocator::reserve(uint32_t idx, uint32_t size)
+{
+    if (static_cast<uint64_t>(idx) + size > m_max_idx)
+    {
+        return false;
+    }
+
+    if (is_free(idx, size) == false)
+    {
+        return false;
+    }
+
+    uint32_t start = previous_used(0, static_cast<int64_t>(idx) - 1) + 1;
+    uint32_t slot = m_starts.find(start);
+
+    assert(likely(slot != invalid_slot));
+
+    uint32_t free_idx = m_ranges[slot].idx;
+    uint32_t free_size = m_ranges[slot].size;
+
+    remove_range(slot);
+
+    if (free_idx < idx)
+    {
+        insert_range(free_idx, idx - free_idx);
+    }
+
+    if (idx + size < free_idx + free_size)
+    {
+        insert_range(idx + size, free_idx + free_size - idx - size);
+    }
+
+    set_free(idx, size, false);
+
+    m_size += size;
+
+    return true;
+}
+
+void allocator::extend(uint32_t size)
+{
+    resize(m_max_idx + size);
+
+    m_size += size;
+    free(m_max_idx, size);
+
+    m_max_idx += size;
+}
+
+uint32_t allocator::capacity() const
+{
+    return m_max_idx;
+}
+
+uint32_t allocator::size() const
+{
+    return m_size;
+}
+
+bool allocator::full() const
+{
+    return m_range_count == 0;
+}
+
+void allocator::histogram(std::vector<uint64_t>* free_ranges) const
+{
+    for (auto&& r : m_ranges)
+    {
+        if (r.size == 0)
+        {
+            continue;
+        }
+
+        uint32_t bucket = 31 - __builtin_clz(r.size);
+
+        if (free_ranges->size() <= bucket)
+        {
+            free_ranges->resize(bucket + 1);
+        }
+
+        (*free_ranges)[bucket]++;
+    }
+}
+
+std::string allocator::serialize() const
+{
+    using free_ranges_t =
+            std::vector<std::pair<uint32_t, uint32_t>>;
+
+    free_ranges_t free_ranges;
+    free_ranges.reserve(m_range_count);
+
+    for (auto&& r : m_ranges)
+    {
+        if (r.size != 0)
+        {
+            free_ranges.emplace_back(r.idx, r.size);
+        }
+    }
+
+    std::sort(free_ranges.begin(), free_ranges.end());
+
+    std::string data;
+
+    data.append(reinterpret_cast<const char*>(&m_max_idx), sizeof(m_max_idx));
+
+    for (auto&& r : free_ranges)
+    {
+        data.append(reinterpret_cast<const char*>(&r.first), sizeof(r.first));
+        data.append(reinterpret_cast<const char*>(&r.second), sizeof(r.second));
+    }
+
+    return data;
+}
+
+void allocator::deserialize(const std::string_view& data)
+{
+    if (data.size() < sizeof(uint32_t) || (data.size() - sizeof(uint32_t)) % (2 * sizeof(uint32_t)) != 0)
+    {
+        throw runtime_error("invalid allocator data");
+    }
+
+    uint32_t capacity;
+    std::memcpy(&capacity, data.data(), sizeof(capacity));
+
+    m_ranges.clear();
+    m_free_slot = invalid_slot;
+    m_range_count = 0;
+
+    for (auto&& heads : m_heads)
+    {
+        heads.fill(invalid_slot);
+    }
+
+    m_fl_bitmap = 0;
+    m_sl_bitmaps.fill(0);
+
+    m_starts.clear();
+    m_ends.clear();
+
+    m_levels.clear();
+    m_levels.resize(1);
+
+    resize(capacity);
+
+    m_max_idx = capacity;
+    m_size = capacity;
+
+    for (uint64_t offset = sizeof(capacity); offset < data.size(); offset += 2 * sizeof(uint32_t))
+    {
+        uint32_t idx;
+        uint32_t size;
+
+        std::memcpy(&idx, data.data() + offset, sizeof(idx));
+        std::memcpy(&size, data.data() + offset + sizeof(idx), sizeof(size));
+
+        if (size == 0 || static_cast<uint64_t>(idx) + size > capacity || is_free(idx, size) == true)
+        {
+            throw runtime_error("invalid allocator data");
+        }
+
+        free(idx, size);
+    }
+}
+
+allocator::allocator()
+{
+    for (auto&& heads : m_heads)
+    {
+        heads.fill(invalid_slot);
+    }
+
+    m_sl_bitmaps.fill(0);
+    m_levels.resize(1);
+}
+
+void allocator::mapping(uint64_t size, uint32_t* fl, uint32_t* sl)
+{
+    if (size < sl_count)
     {
-        m_free_set.insert((static_cast<uint64_t>(size) << 32) | idx);
-        m_idx_set.insert((static_cast<uint64_t>(idx) << 32) | size);
+        *fl = 0;
+        *sl = size;
 
         return;
     }
 
-    auto it = m_idx_set.lower_bound(static_cast<uint64_t>(idx) << 32);
+    uint32_t log = 63 - __builtin_clzll(size);
+
+    *fl = log - sl_bits + 1;
+    *sl = (size >> (log - sl_bits)) & (sl_count - 1);
+}
+
+uint32_t allocator::find_suitable(uint32_t size) const
+{
+    uint64_t search_size = size;
+
+    if (search_size >= sl_count)
+    {
+        search_size += (1UL << (63 - __builtin_clzll(search_size) - sl_bits)) - 1;
+    }
+
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(search_size, &fl, &sl);
+
+    if (fl >= fl_count)
+    {
+        return invalid_slot;
+    }
 
-    auto prev_it = m_idx_set.end();
-    auto next_it = m_idx_set.end();
+    uint32_t sl_bitmap = m_sl_bitmaps[fl] & (~0U << sl);
 
-    if (it != m_idx_set.end())
+    if (sl_bitmap == 0)
     {
-        next_it = it;
+        uint32_t fl_bitmap = m_fl_bitmap & (~0U << (fl + 1));
 
-        if (it != m_idx_set.begin())
+        if (fl_bitmap == 0)
         {
-            prev_it = --it;
+            return invalid_slot;
         }
+
+        fl = __builtin_ctz(fl_bitmap);
+        sl_bitmap = m_sl_bitmaps[fl];
+    }
+
+    sl = __builtin_ctz(sl_bitmap);
+
+    return m_heads[fl][sl];
+}
+
+uint32_t allocator::insert_range(uint32_t idx, uint32_t size)
+{
+    uint32_t slot = m_free_slot;
+
+    if (slot == invalid_slot)
+    {
+        slot = m_ranges.size();
+        m_ranges.emplace_back();
     }
     else
     {
-        prev_it = --it;
+        m_free_slot = m_ranges[slot].next;
     }
 
-    if (prev_it != m_idx_set.end())
+    auto& r = m_ranges[slot];
+
+    r.idx = idx;
+    r.size = size;
+
+    link(slot);
+
+    m_starts.insert(idx, slot);
+    m_ends.insert(idx + size, slot);
+
+    m_range_count++;
+
+    return slot;
+}
+
+void allocator::remove_range(uint32_t slot)
+{
+    auto& r = m_ranges[slot];
+
+    unlink(slot);
+
+    m_starts.erase(r.idx);
+    m_ends.erase(r.idx + r.size);
+
+    r.size = 0;
+    r.next = m_free_slot;
+
+    m_free_slot = slot;
+
+    assert(likely(m_range_count != 0));
+    m_range_count--;
+}
+
+void allocator::link(uint32_t slot)
+{
+    auto& r = m_ranges[slot];
+
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(r.size, &fl, &sl);
+
+    auto& head = m_heads[fl][sl];
+
+    r.prev = invalid_slot;
+    r.next = head;
+
+    if (head != invalid_slot)
+    {
+        m_ranges[head].prev = slot;
+    }
+
+    head = slot;
+
+    m_fl_bitmap |= 1U << fl;
+    m_sl_bitmaps[fl] |= 1U << sl;
+}
+
+void allocator::unlink(uint32_t slot)
+{
+    auto& r = m_ranges[slot];
+
+    uint32_t fl;
+    uint32_t sl;
+
+    mapping(r.size, &fl, &sl);
+
+    auto& head = m_heads[fl][sl];
+
+    if (r.prev != invalid_slot)
+    {
+        m_ranges[r.prev].next = r.next;
+    }
+    else
+    {
+        assert(likely(head == slot));
+        head = r.next;
+    }
+
+    if (r.next != invalid_slot)
+    {
+        m_ranges[r.next].prev = r.prev;
+    }
+
+    if (head == invalid_slot)
+    {
+        m_sl_bitmaps[fl] &= ~(1U << sl);
+
+        if (m_sl_bitmaps[fl] == 0)
+        {
+            m_fl_bitmap &= ~(1U << fl);
+        }
+    }
+}
+
+void allocator::resize(uint32_t capacity)
+{
+    uint64_t words = (static_cast<uint64_t>(capacity) + 63) >> 6;
+
+    for (uint32_t level = 0; ; level++)
     {
-        uint32_t prev_idx = *prev_it >> 32;
-        uint32_t prev_size = *prev_it & 0xffffffffU;
+        if (level == m_levels.size())
+        {
+            auto& below = m_levels[level - 1];
+            bitmap_t bits(words, 0);
+
+            for (uint64_t word = 0; word < below.size(); word++)
+            {
+                if (below[word] == static_cast<uint64_t>(-1))
+                {
+                    bits[word >> 6] |= 1UL << (word & 63);
+                }
+            }
 
-        if (prev_idx + prev_size == idx)
+            m_levels.emplace_back(std::move(bits));
+        }
+        else
         {
-            idx = prev_idx;
-            size += prev_size;
+            m_levels[level].resize(words, 0);
+        }
 
-            m_idx_set.erase(prev_it);
-            m_free_set.erase((static_cast<uint64_t>(prev_size) << 32) | prev_idx);
+        if (words <= 1)
+        {
+            break;
         }
+
+        words = (words + 63) >> 6;
     }
+}
+
+void allocator::set_free(uint32_t idx, uint32_t size, bool free)
+{
+    uint64_t position = idx;
+    uint64_t end = position + size;
 
-    if (next_it != m_idx_set.end())
+    auto& bits = m_levels[0];
+
+    while (position < end)
     {
-        uint32_t next_idx = *next_it >> 32;
-        uint32_t next_size = *next_it & 0xffffffffU;
+        uint64_t word = position >> 6;
+        uint64_t bit = position & 63;
+        uint64_t count = std::min(64 - bit, end - position);
+
+        uint64_t mask = count == 64 ? static_cast<uint64_t>(-1) : ((1UL << count) - 1) << bit;
 
-        if (idx + size == next_idx)
+        if (free == true)
         {
-            size += next_size;
+            bits[word] |= mask;
+        }
+        else
+        {
+            bits[word] &= ~mask;
+        }
 
-            m_idx_set.erase(next_it);
-            m_free_set.erase((static_cast<uint64_t>(next_size) << 32) | next_idx);
+        update_summary(0, word);
+
+        position += count;
+    }
+}
+
+bool allocator::is_free(uint32_t idx, uint32_t size) const
+{
+    uint64_t position = idx;
+    uint64_t end = position + size;
+
+    auto& bits = m_levels[0];
+
+    while (position < end)
+    {
+        uint64_t word = position >> 6;
+        uint64_t bit = position & 63;
+        uint64_t count = std::min(64 - bit, end - position);
+
+        uint64_t mask = count == 64 ? static_cast<uint64_t>(-1) : ((1UL << count) - 1) << bit;
+
+        if ((bits[word] & mask) != mask)
+        {
+            return false;
         }
+
+        position += count;
     }
 
-    m_free_set.insert((static_cast<uint64_t>(size) << 32) | idx);
-    m_idx_set.insert((static_cast<uint64_t>(idx) << 32) | size);
+    return true;
 }
 
-void allocator::extend(uint32_t size)
+void allocator::update_summary(uint32_t level, uint64_t word)
 {
-    m_size += size;
-    free(m_max_idx, size);
+    if (level + 1 == m_levels.size())
+    {
+        return;
+    }
 
-    m_max_idx += size;
+    auto& summary = m_levels[level + 1][word >> 6];
+
+    uint64_t bit = 1UL << (word & 63);
+    uint64_t value = summary;
+
+    if (m_levels[level][word] == static_cast<uint64_t>(-1))
+    {
+        value |= bit;
+    }
+    else
+    {
+        value &= ~bit;
+    }
+
+    if (value != summary)
+    {
+        summary = value;
+        update_summary(level + 1, word >> 6);
+    }
 }
 
-uint32_t allocator::capacity() const
+int64_t allocator::previous_used(uint32_t level, int64_t position) const
 {
-    return m_max_idx;
+    if (position < 0)
+    {
+        return -1;
+    }
+
+    auto& bits = m_levels[level];
+
+    int64_t word = position >> 6;
+    uint64_t bit = position & 63;
+
+    uint64_t mask = bit == 63 ? static_cast<uint64_t>(-1) : (1UL << (bit + 1)) - 1;
+    uint64_t used = ~bits[word] & mask;
+
+    if (used == 0)
+    {
+        if (level + 1 < m_levels.size())
+        {
+            word = previous_used(level + 1, word - 1);
+        }
+        else
+        {
+            do
+            {
+                word--;
+            }
+            while (word >= 0 && bits[word] == static_cast<uint64_t>(-1));
+        }
+
+        if (word < 0)
+        {
+            return -1;
+        }
+
+        used = ~bits[word];
+    }
+
+    return (word << 6) + 63 - __builtin_clzll(used);
 }
 
-uint32_t allocator::size() const
+uint32_t allocator::index::find(uint32_t key) const
 {
-    return m_size;
+    uint64_t mask = m_table.size() - 1;
+
+    for (uint64_t i = position(key); m_table[i] != empty; i = (i + 1) & mask)
+    {
+        if ((m_table[i] >> 32) == key)
+        {
+            return m_table[i] & 0xffffffffU;
+        }
+    }
+
+    return invalid_slot;
 }
 
-bool allocator::full() const
+void allocator::index::insert(uint32_t key, uint32_t value)
 {
-    return m_free_set.size() == 0;
+    if ((m_count + 1) * 2 > m_table.size())
+    {
+        grow();
+    }
+
+    uint64_t mask = m_table.size() - 1;
+    uint64_t i = position(key);
+
+    while (m_table[i] != empty)
+    {
+        i = (i + 1) & mask;
+    }
+
+    m_table[i] = (static_cast<uint64_t>(key) << 32) | value;
+    m_count++;
+}
+
+void allocator::index::erase(uint32_t key)
+{
+    uint64_t mask = m_table.size() - 1;
+    uint64_t i = position(key);
+
+    while ((m_table[i] >> 32) != key)
+    {
+        assert(likely(m_table[i] != empty));
+        i = (i + 1) & mask;
+    }
+
+    m_table[i] = empty;
+    m_count--;
+
+    for (uint64_t j = (i + 1) & mask; m_table[j] != empty; j = (j + 1) & mask)
+    {
+        uint64_t home = home_of(m_table[j]);
+
+        bool in_place = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+
+        if (in_place == false)
+        {
+            m_table[i] = m_table[j];
+            m_table[j] = empty;
+
+            i = j;
+        }
+    }
+}
+
+void allocator::index::clear()
+{
+    m_bits = 4;
+    m_count = 0;
+
+    m_table.assign(1UL << m_bits, empty);
+}
+
+allocator::index::index()
+{
+    clear();
+}
+
+uint64_t allocator::index::position(uint32_t key) const
+{
+    return (key * 0x9e3779b97f4a7c15ULL) >> (64 - m_bits);
+}
+
+uint64_t allocator::index::home_of(uint64_t entry) const
+{
+    return position(entry >> 32);
+}
+
+void allocator::index::grow()
+{
+    table_t table(1UL << (m_bits + 1), empty);
+    std::swap(table, m_table);
+
+    m_bits++;
+    m_count = 0;
+
+    for (auto&& entry : table)
+    {
+        if (entry != empty)
+        {
+            insert(entry >> 32, entry & 0xffffffffU);
+        }
+    }
 }
 
 }
@@ -3,7 +3,10 @@
 
 #include <common/disallow_copy.h>
 
-#include <set>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <cstdint>
 
 
@@ -16,22 +19,123 @@ public:
     uint32_t allocate(uint32_t size);
     void free(uint32_t idx, uint32_t size);
 
+    bool reserve(uint32_t idx, uint32_t size);
+
     void extend(uint32_t size);
 
     uint32_t capacity() const;
     uint32_t size() const;
     bool full() const;
 
+    void histogram(std::vector<uint64_t>* free_ranges) const;
+
+    std::string serialize() const;
+    void deserialize(const std::string_view& data);
+
+public:
+    allocator();
+
 private:
-    using set_t =
-            std::set<uint64_t>;
+    static constexpr uint32_t invalid_slot{static_cast<uint32_t>(-1)};
+
+    static constexpr uint32_t sl_bits{4};
+    static constexpr uint32_t sl_count{1U << sl_bits};
+    static constexpr uint32_t fl_count{32 - sl_bits + 1};
+
+private:
+    struct range
+    {
+        uint32_t idx{0};
+        uint32_t size{0};
+
+        uint32_t prev{invalid_slot};
+        uint32_t next{invalid_slot};
+    };
+
+    class index
+    {
+    public:
+        uint32_t find(uint32_t key) const;
+
+        void insert(uint32_t key, uint32_t value);
+        void erase(uint32_t key);
+
+        void clear();
+
+    public:
+        index();
+
+    private:
+        static constexpr uint64_t empty{static_cast<uint64_t>(-1)};
+
+    private:
+        using table_t =
+                std::vector<uint64_t>;
+
+    private:
+        table_t m_table;
+
+        uint32_t m_bits{0};
+        uint32_t m_count{0};
+
+    private:
+        uint64_t position(uint32_t key) const;
+        uint64_t home_of(uint64_t entry) const;
+
+        void grow();
+    };
+
+    using ranges_t =
+            std::vector<range>;
+
+    using heads_t =
+            std::array<std::array<uint32_t, sl_count>, fl_count>;
+
+    using sl_bitmaps_t =
+            std::array<uint32_t, fl_count>;
+
+    using bitmap_t =
+            std::vector<uint64_t>;
+
+    using levels_t =
+            std::vector<bitmap_t>;
 
 private:
-    set_t m_free_set;
-    set_t m_idx_set;
+    ranges_t m_ranges;
+    uint32_t m_free_slot{invalid_slot};
+    uint32_t m_range_count{0};
+
+    heads_t m_heads;
+
+    uint32_t m_fl_bitmap{0};
+    sl_bitmaps_t m_sl_bitmaps;
+
+    index m_starts;
+    index m_ends;
+
+    levels_t m_levels;
 
     uint32_t m_max_idx{0};
     uint32_t m_size{0};
+
+private:
+    static void mapping(uint64_t size, uint32_t* fl, uint32_t* sl);
+
+    uint32_t find_suitable(uint32_t size) const;
+
+    uint32_t insert_range(uint32_t idx, uint32_t size);
+    void remove_range(uint32_t slot);
+
+    void link(uint32_t slot);
+    void unlink(uint32_t slot);
+
+    void resize(uint32_t capacity);
+
+    void set_free(uint32_t idx, uint32_t size, bool free);
+    bool is_free(uint32_t idx, uint32_t size) const;
+
+    void update_summary(uint32_t level, uint64_t word);
+    int64_t previous_used(uint32_t level, int64_t position) const;
 };
 
 }
@@ -68,6 +68,7 @@ void cmd_line::add_separator()
     }
 
     m_arg_table.push_back(arg);
+    m_arg_types.push_back(false);
 }
 
 bool cmd_line::flag(const char* name)
@@ -230,6 +231,7 @@ void cmd_line::add_other_glossary_lines(const glossary_t& glossary)
         }
 
         m_arg_table.push_back(arg);
+        m_arg_types.push_back(false);
     }
 }
 
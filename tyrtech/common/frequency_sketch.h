@@ -0,0 +1,175 @@
+#pragma once
+
+
+#include <common/disallow_copy.h>
+
+#include <atomic>
+#include <array>
+#include <limits>
+#include <memory>
+
+#include <cstdint>
+
+
+namespace tyrtech {
+
+
+class frequency_sketch : private disallow_copy
+{
+public:
+    uint32_t frequency(uint64_t hash)
+    {
+        return m_sketches[hash & sketches_mask].frequency(hash >> sketches_bits);
+    }
+
+    void increment(uint64_t hash)
+    {
+        m_sketches[hash & sketches_mask].increment(hash >> sketches_bits);
+    }
+
+public:
+    frequency_sketch(uint32_t max_items)
+    {
+        for (auto&& sketch : m_sketches)
+        {
+            sketch.initialize(max_items / m_sketches.size());
+        }
+    }
+
+private:
+    static constexpr uint32_t sketches_bits{12};
+    static constexpr uint64_t sketches_mask{(1UL << sketches_bits) - 1};
+
+private:
+    struct sketch
+    {
+        void initialize(uint32_t max_items)
+        {
+            max_samples = max_items * 10;
+
+            table_size = 1U << (32 - __builtin_clz(max_items));
+            table_mask = table_size - 1;
+
+            table = std::make_unique<counter_t[]>(table_size);
+        }
+
+        uint32_t frequency(uint32_t hash)
+        {
+            uint32_t start = (hash & 3) << 2;
+
+            uint32_t frequency = std::numeric_limits<uint32_t>::max();
+
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                uint32_t index = index_of(hash, i);
+                uint32_t count = static_cast<uint32_t>(load(index) >>
+                                                       (((start + i) << 2) & 0x0fU));
+
+                frequency = std::min(frequency, count);
+            }
+
+            return frequency;
+        }
+
+        void increment(uint32_t hash)
+        {
+            uint32_t start = (hash & 3) << 2;
+
+            bool added = true;
+
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                uint32_t index = index_of(hash, i);
+                added |= increment_at(index, start + i);
+            }
+
+            if (added == true)
+            {
+                uint32_t s = samples.load(std::memory_order_relaxed) + 1;
+                samples.store(s, std::memory_order_relaxed);
+
+                if (s == max_samples)
+                {
+                    reset();
+                }
+            }
+        }
+
+        bool increment_at(uint32_t i, uint32_t j)
+        {
+            uint32_t offset = j << 2;
+            uint64_t mask = (0x0fUL << offset);
+
+            uint64_t counters = load(i);
+
+            if ((counters & mask) != mask)
+            {
+                store(i, counters + (1UL << offset));
+
+                return true;
+            }
+
+            return false;
+        }
+
+        void reset()
+        {
+            uint32_t count = 0;
+
+            for (uint32_t i = 0; i < table_size; i++)
+            {
+                uint64_t counters = load(i);
+
+                count += __builtin_popcountll(counters & 0x1111111111111111UL);
+                store(i, (counters >> 1) & 0x7777777777777777UL);
+            }
+
+            uint32_t s = samples.load(std::memory_order_relaxed);
+            samples.store((s >> 1) - (count >> 2), std::memory_order_relaxed);
+        }
+
+        uint64_t load(uint32_t i) const
+        {
+            return table[i].load(std::memory_order_relaxed);
+        }
+
+        void store(uint32_t i, uint64_t counters)
+        {
+            table[i].store(counters, std::memory_order_relaxed);
+        }
+
+        uint32_t index_of(uint32_t item, uint32_t i)
+        {
+            static uint64_t seeds[] = {
+                0xc3a5c85c97cb3127UL,
+                0xb492b66fbe98f273UL,
+                0x9ae16a3b2f90404fUL,
+                0xcbf29ce484222325UL
+            };
+
+            uint64_t hash = seeds[i] * item;
+            hash += hash >> 32;
+
+            return static_cast<uint32_t>(hash) & table_mask;
+        }
+
+        using counter_t =
+                std::atomic<uint64_t>;
+
+        std::unique_ptr<counter_t[]> table;
+
+        uint32_t table_size{0};
+        uint64_t table_mask{0};
+
+        uint32_t max_samples{0};
+        std::atomic<uint32_t> samples{0};
+    };
+
+    using sketches_t =
+            std::array<sketch, 1U << sketches_bits>;
+
+private:
+    sketches_t m_sketches;
+};
+
+}
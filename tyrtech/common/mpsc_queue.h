@@ -0,0 +1,102 @@
+#pragma once
+
+
+#include <common/disallow_copy.h>
+#include <common/disallow_move.h>
+#include <common/branch_prediction.h>
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+
+namespace tyrtech {
+
+
+template<typename T, uint32_t size>
+class mpsc_queue : private disallow_copy, disallow_move
+{
+public:
+    template<typename Item>
+    bool push(Item&& item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        cell* c;
+
+        while (true)
+        {
+            c = &m_cells[head & mask];
+
+            int32_t diff = c->sequence.load(std::memory_order_acquire) - head;
+
+            if (diff == 0)
+            {
+                if (m_head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed) == true)
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                head = m_head.load(std::memory_order_relaxed);
+            }
+        }
+
+        c->item = std::forward<Item>(item);
+        c->sequence.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool pop(T* item)
+    {
+        cell* c = &m_cells[m_tail & mask];
+
+        int32_t diff = c->sequence.load(std::memory_order_acquire) - (m_tail + 1);
+
+        if (diff < 0)
+        {
+            return false;
+        }
+
+        *item = std::move(c->item);
+        c->sequence.store(m_tail + size, std::memory_order_release);
+
+        m_tail++;
+
+        return true;
+    }
+
+public:
+    mpsc_queue()
+    {
+        for (uint32_t i = 0; i < size; i++)
+        {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static_assert((size & (size - 1)) == 0, "size must be a power of two");
+
+    static constexpr uint32_t mask{size - 1};
+
+private:
+    struct cell
+    {
+        std::atomic<uint32_t> sequence{0};
+        T item;
+    };
+
+private:
+    alignas(64) std::atomic<uint32_t> m_head{0};
+    alignas(64) uint32_t m_tail{0};
+
+    alignas(64) std::array<cell, size> m_cells;
+};
+
+}
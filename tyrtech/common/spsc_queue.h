@@ -0,0 +1,81 @@
+#pragma once
+
+
+#include <common/disallow_copy.h>
+#include <common/disallow_move.h>
+#include <common/branch_prediction.h>
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+
+namespace tyrtech {
+
+
+template<typename T, uint32_t size>
+class spsc_queue : private disallow_copy, disallow_move
+{
+public:
+    template<typename Item>
+    bool push(Item&& item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head - m_cached_tail == size)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+
+            if (head - m_cached_tail == size)
+            {
+                return false;
+            }
+        }
+
+        m_queue[head & mask] = std::forward<Item>(item);
+        m_head.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool pop(T* item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+
+        if (tail == m_cached_head)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+
+            if (tail == m_cached_head)
+            {
+                return false;
+            }
+        }
+
+        *item = std::move(m_queue[tail & mask]);
+        m_tail.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    static_assert((size & (size - 1)) == 0, "size must be a power of two");
+
+    static constexpr uint32_t mask{size - 1};
+
+private:
+    alignas(64) std::atomic<uint32_t> m_head{0};
+    uint32_t m_cached_tail{0};
+
+    alignas(64) std::atomic<uint32_t> m_tail{0};
+    uint32_t m_cached_head{0};
+
+    alignas(64) std::array<T, size> m_queue;
+};
+
+}
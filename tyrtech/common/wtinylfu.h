@@ -3,10 +3,12 @@
 
 #include <common/branch_prediction.h>
 #include <common/disallow_copy.h>
+#include <common/frequency_sketch.h>
 
 #include <unordered_map>
 #include <vector>
 #include <list>
+#include <memory>
 
 #include <cstdint>
 #include <cassert>
@@ -15,7 +17,22 @@
 namespace tyrtech {
 
 
-template<typename Key, typename Item, typename KeyHasher = std::hash<Key>>
+template<typename Item>
+struct unit_weigher
+{
+    static constexpr uint64_t typical_weight{1};
+
+    uint64_t operator()(const Item& item) const
+    {
+        return 1;
+    }
+};
+
+
+template<typename Key,
+         typename Item,
+         typename KeyHasher = std::hash<Key>,
+         typename Weigher = unit_weigher<Item>>
 class wtinylfu : private disallow_copy
 {
 public:
@@ -31,48 +48,62 @@ public:
 
         touch(it);
 
-        assert(likely(m_window.size() <= m_window.max_items));
-        assert(likely(m_main_a1.size() <= m_main_a1.max_items));
-        assert(likely(m_main_a2.size() <= m_main_a2.max_items));
+        assert(likely(m_window.is_within_budget() == true));
+        assert(likely(m_main_a1.is_within_budget() == true));
+        assert(likely(m_main_a2.is_within_budget() == true));
 
         return it->item;
     }
 
+    bool contains(const Key& key)
+    {
+        return find(key) != iterator_t();
+    }
+
     Item set(const Key& key, const Item& item)
     {
         assert(likely(key != Key()));
         assert(likely(find(key) == iterator_t()));
 
-        Item old_item = evict_if_necessary();
+        uint64_t weight = Weigher{}(item);
+
+        Item old_item = evict_if_necessary(weight);
 
-        auto it = create(key);
+        auto it = create(key, weight);
         it->item = item;
 
-        assert(likely(m_window.size() <= m_window.max_items));
-        assert(likely(m_main_a1.size() <= m_main_a1.max_items));
-        assert(likely(m_main_a2.size() <= m_main_a2.max_items));
+        assert(likely(m_window.is_within_budget() == true));
+        assert(likely(m_main_a1.is_within_budget() == true));
+        assert(likely(m_main_a2.is_within_budget() == true));
 
         return old_item;
     }
 
-    Item evict_if_necessary()
+    Item evict_if_necessary(uint64_t weight)
     {
-        if (m_window.is_full() == false)
-        {
-            return m_empty_item;
-        }
+        Item old_item = m_empty_item;
 
-        if (m_main_a1.is_full() == false)
+        while (m_window.is_full(weight) == true)
         {
             auto it = m_window.eviction_candidate();
 
-            it->location = item::location::MAIN_A1;
-            m_main_a1.move(it, &m_window);
+            if (m_main_a1.is_full(it->weight) == false)
+            {
+                it->location = item::location::MAIN_A1;
+                m_main_a1.move(it, &m_window);
+
+                continue;
+            }
 
-            return m_empty_item;
+            old_item = evict_worse_candidate();
         }
 
-        return evict_worse_candidate();
+        return old_item;
+    }
+
+    uint64_t weight() const
+    {
+        return m_window.weight + m_main_a1.weight + m_main_a2.weight;
     }
 
     Item evict()
@@ -124,20 +155,30 @@ public:
     }
 
 public:
-    wtinylfu(uint32_t max_items)
+    wtinylfu(uint64_t max_weight)
+      : wtinylfu(max_weight, nullptr)
     {
+    }
+
+    wtinylfu(uint64_t max_weight, frequency_sketch* sketch)
+    {
+        uint64_t max_items = max_weight / Weigher::typical_weight;
+
         assert(likely(max_items >= 100));
 
-        m_window.initialize(max_items / 100);
-        m_main_a1.initialize(2 * (max_items - m_window.max_items) / 10);
-        m_main_a2.initialize(max_items - m_window.max_items - m_main_a1.max_items);
+        m_window.initialize(max_weight / 100);
+        m_main_a1.initialize(2 * (max_weight - m_window.max_weight) / 10);
+        m_main_a2.initialize(max_weight - m_window.max_weight - m_main_a1.max_weight);
 
         m_map.reserve(max_items);
 
-        for (auto&& counter : m_counters)
+        if (sketch == nullptr)
         {
-            counter.initialize(max_items / m_counters.size());
+            m_own_sketch = std::make_unique<frequency_sketch>(max_items);
+            sketch = m_own_sketch.get();
         }
+
+        m_sketch = sketch;
     }
 
 private:
@@ -154,6 +195,8 @@ private:
 
         Key  key;
         Item item;
+
+        uint64_t weight{0};
     };
 
 private:
@@ -172,20 +215,26 @@ private:
         list_t list;
 
         uint32_t items{0};
-        uint32_t max_items{0};
 
-        void initialize(uint32_t max_items)
+        uint64_t weight{0};
+        uint64_t max_weight{0};
+
+        void initialize(uint64_t max_weight)
         {
-            this->max_items = max_items;
+            this->max_weight = max_weight;
         }
 
-        iterator_t create(const Key& key)
+        iterator_t create(const Key& key, uint64_t weight)
         {
-            assert(likely(items != max_items));
+            assert(likely(is_full(weight) == false));
+
             items++;
+            this->weight += weight;
 
             item item;
+
             item.key = key;
+            item.weight = weight;
 
             list.push_front(item);
 
@@ -200,7 +249,9 @@ private:
         void evict(const iterator_t& it)
         {
             assert(likely(items != 0));
+
             items--;
+            weight -= it->weight;
 
             list.erase(it);
         }
@@ -208,7 +259,10 @@ private:
         void move(const iterator_t& it, lru* source)
         {
             items++;
+            weight += it->weight;
+
             source->items--;
+            source->weight -= it->weight;
 
             list.splice(list.begin(), source->list, it);
         }
@@ -218,134 +272,27 @@ private:
             return items;
         }
 
-        bool is_full() const
+        bool is_full(uint64_t weight) const
         {
-            if (items == max_items)
+            if (items != 0 && this->weight + weight > max_weight)
             {
                 return true;
             }
 
             return false;
         }
-    };
 
-    struct frequency_sketch
-    {
-        void initialize(uint32_t max_items)
+        bool is_over_budget() const
         {
-            max_samples = max_items * 10;
-
-            table.resize(1U << (32 - __builtin_clz(max_items)));
-            table_mask = table.size() - 1;
+            return items > 1 && weight > max_weight;
         }
 
-        uint32_t frequency(uint32_t hash)
+        bool is_within_budget() const
         {
-            uint32_t start = (hash & 3) << 2;
-
-            uint32_t frequency = std::numeric_limits<uint32_t>::max();
-
-            for (uint32_t i = 0; i < 4; i++)
-            {
-                uint32_t index = index_of(hash, i);
-                uint32_t count = static_cast<uint32_t>(table[index] >>
-                                                       (((start + i) << 2) & 0x0fU));
-
-                frequency = std::min(frequency, count);
-            }
-
-            return frequency;
+            return is_over_budget() == false;
         }
-
-        void increment(uint32_t hash)
-        {
-            uint32_t start = (hash & 3) << 2;
-
-            bool added = true;
-
-            for (uint32_t i = 0; i < 4; i++)
-            {
-                uint32_t index = index_of(hash, i);
-                added |= increment_at(index, start + i);
-            }
-
-            if (added == true)
-            {
-                samples++;
-
-                if (samples == max_samples)
-                {
-                    reset();
-                }
-            }
-        }
-
-        bool increment_at(uint32_t i, uint32_t j)
-        {
-            uint32_t offset = j << 2;
-            uint64_t mask = (0x0fUL << offset);
-
-            if ((table[i] & mask) != mask)
-            {
-                table[i] += 1UL << offset;
-
-                return true;
-            }
-
-            return false;
-        }
-
-        void reset()
-        {
-            uint32_t count = 0;
-
-            for (auto&& counters : table)
-            {
-                count += __builtin_popcountll(counters & 0x1111111111111111UL);
-                counters = (counters >> 1) & 0x7777777777777777UL;
-            }
-
-            samples = (samples >> 1) - (count >> 2);
-        }
-
-        uint32_t index_of(uint32_t item, uint32_t i)
-        {
-            static uint64_t seeds[] = {
-                0xc3a5c85c97cb3127UL,
-                0xb492b66fbe98f273UL,
-                0x9ae16a3b2f90404fUL,
-                0xcbf29ce484222325UL
-            };
-
-            uint64_t hash = seeds[i] * item;
-            hash += hash >> 32;
-
-            return static_cast<uint32_t>(hash) & table_mask;
-        }
-
-        uint32_t spread(uint32_t x)
-        {
-            x = ((x >> 16) ^ x) * 0x45d9f3bU;
-            x = ((x >> 16) ^ x) * 0x45d9f3bU;
-
-            return (x >> 16) ^ x;
-        }
-
-        using table_t =
-                std::vector<uint64_t>;
-
-        table_t table;
-
-        uint64_t table_mask{0};
-
-        uint32_t max_samples{0};
-        uint32_t samples{0};
     };
 
-private:
-    using counters_t =
-            std::array<frequency_sketch, 4096>;
-
 private:
     lru m_window;
     lru m_main_a1;
@@ -353,14 +300,15 @@ private:
 
     map_t m_map;
 
-    counters_t m_counters;
+    std::unique_ptr<frequency_sketch> m_own_sketch;
+    frequency_sketch* m_sketch{nullptr};
 
     Item m_empty_item;
 
 private:
-    iterator_t create(const Key& key)
+    iterator_t create(const Key& key, uint64_t weight)
     {
-        auto it = m_window.create(key);
+        auto it = m_window.create(key, weight);
 
         assert(likely(m_map.find(key) == m_map.end()));
         m_map[key] = it;
@@ -384,20 +332,23 @@ private:
             }
             case item::location::MAIN_A1:
             {
-                if (m_main_a2.is_full() == true)
-                {
-                    it->location = item::location::MAIN_A2;
-                    m_main_a2.move(it, &m_main_a1);
+                it->location = item::location::MAIN_A2;
+                m_main_a2.move(it, &m_main_a1);
 
+                while (m_main_a2.is_over_budget() == true)
+                {
                     auto it1 = m_main_a2.eviction_candidate();
 
                     it1->location = item::location::MAIN_A1;
                     m_main_a1.move(it1, &m_main_a2);
                 }
-                else
+
+                while (m_main_a1.is_over_budget() == true)
                 {
-                    it->location = item::location::MAIN_A2;
-                    m_main_a2.move(it, &m_main_a1);
+                    auto it1 = m_main_a1.eviction_candidate();
+
+                    m_map.erase(it1->key);
+                    m_main_a1.evict(it1);
                 }
 
                 break;
@@ -425,8 +376,11 @@ private:
             m_map.erase(it2->key);
             m_main_a1.evict(it2);
 
-            it1->location = item::location::MAIN_A1;
-            m_main_a1.move(it1, &m_window);
+            if (m_main_a1.is_full(it1->weight) == false)
+            {
+                it1->location = item::location::MAIN_A1;
+                m_main_a1.move(it1, &m_window);
+            }
         }
         else
         {
@@ -453,14 +407,12 @@ private:
 
     uint32_t frequency(const Key& key)
     {
-        auto hash = KeyHasher{}(key);
-        return m_counters[hash & 0xfff].frequency(hash >> 12);
+        return m_sketch->frequency(KeyHasher{}(key));
     }
 
     void increment(const Key& key)
     {
-        auto hash = KeyHasher{}(key);
-        m_counters[hash & 0xfff].increment(hash >> 12);
+        m_sketch->increment(KeyHasher{}(key));
     }
 };
 
@@ -4,78 +4,277 @@
 namespace tyrtech::gt::async {
 
 
-void job::run(function_t&& function)
+class pool : private disallow_copy, disallow_move
 {
-    m_done = false;
+public:
+    void queue(jobs* jobs);
+    void dequeue(jobs* jobs);
 
-    auto f = [this]
+    tasks_t acquire_tasks();
+    void release_tasks(tasks_t&& tasks);
+
+    void set_stack_size(stack_size size);
+
+public:
+    pool(uint32_t max_workers);
+
+private:
+    using spare_tasks_t =
+            std::vector<tasks_t>;
+
+private:
+    uint32_t m_max_workers{0};
+    uint32_t m_workers{0};
+
+    stack_size m_stack_size{stack_size::large};
+
+    jobs* m_head{nullptr};
+    jobs* m_tail{nullptr};
+
+    context_queue_t m_idle{new_context_queue()};
+
+    spare_tasks_t m_spare_tasks;
+
+private:
+    void worker_thread();
+    void terminate();
+};
+
+
+thread_local std::unique_ptr<pool> __pool;
+
+
+void pool::queue(jobs* jobs)
+{
+    if (jobs->m_queued == false)
     {
-        this->signal();
-    };
+        jobs->m_prev = m_tail;
+        jobs->m_next = nullptr;
+
+        if (m_tail != nullptr)
+        {
+            m_tail->m_next = jobs;
+        }
+        else
+        {
+            m_head = jobs;
+        }
 
-    auto ctx = create_thread(function);
-    set_terminate_callback(ctx, std::move(f));
+        m_tail = jobs;
+        jobs->m_queued = true;
+    }
+
+    if (m_idle.empty() == false)
+    {
+        context_t ctx = *m_idle.front_item();
+        m_idle.pop_front();
+
+        set_user_context(ctx, true);
+        set_priority(ctx, jobs->m_priority);
+
+        enqueue(ctx);
+    }
+    else if (m_workers < m_max_workers)
+    {
+        m_workers++;
+        create_thread(m_stack_size, &pool::worker_thread, this);
+    }
 }
 
-void job::wait()
+void pool::dequeue(jobs* jobs)
 {
-    if (m_done == true)
+    if (jobs->m_queued == false)
     {
         return;
     }
 
-    m_wait_queue.push_back(current_context());
+    if (jobs->m_prev != nullptr)
+    {
+        jobs->m_prev->m_next = jobs->m_next;
+    }
+    else
+    {
+        m_head = jobs->m_next;
+    }
+
+    if (jobs->m_next != nullptr)
+    {
+        jobs->m_next->m_prev = jobs->m_prev;
+    }
+    else
+    {
+        m_tail = jobs->m_prev;
+    }
+
+    jobs->m_prev = nullptr;
+    jobs->m_next = nullptr;
 
-    yield(false);
+    jobs->m_queued = false;
+}
+
+tasks_t pool::acquire_tasks()
+{
+    if (m_spare_tasks.empty() == true)
+    {
+        return tasks_t();
+    }
+
+    tasks_t tasks = std::move(m_spare_tasks.back());
+    m_spare_tasks.pop_back();
 
-    assert(likely(m_done == true));
+    return tasks;
 }
 
-void job::signal()
+void pool::release_tasks(tasks_t&& tasks)
 {
-    m_done = true;
+    tasks.clear();
+    m_spare_tasks.push_back(std::move(tasks));
+}
 
-    while (m_wait_queue.empty() == false)
+void pool::set_stack_size(stack_size size)
+{
+    m_stack_size = size;
+}
+
+pool::pool(uint32_t max_workers)
+  : m_max_workers(max_workers)
+{
+    at_terminate(std::bind(&pool::terminate, this));
+}
+
+void pool::worker_thread()
+{
+    while (true)
+    {
+        if (m_head != nullptr)
+        {
+            jobs* jobs = m_head;
+
+            {
+                task task = jobs->next_task();
+
+                if (jobs->pending() == false)
+                {
+                    dequeue(jobs);
+                }
+
+                set_user_context(current_context(), true);
+                set_priority(current_context(), jobs->m_priority);
+
+                jobs->m_running++;
+                task();
+            }
+
+            jobs->done();
+
+            continue;
+        }
+
+        set_user_context(current_context(), false);
+
+        if (terminated() == true)
+        {
+            break;
+        }
+
+        m_idle.push_back(current_context());
+        yield(false);
+    }
+
+    m_workers--;
+}
+
+void pool::terminate()
+{
+    while (m_idle.empty() == false)
     {
-        context_t ctx = *m_wait_queue.front_item();
-        m_wait_queue.pop_front();
+        context_t ctx = *m_idle.front_item();
+        m_idle.pop_front();
 
         enqueue(ctx);
     }
 }
 
+
 void jobs::wait()
 {
-    while (m_jobs.empty() == false)
+    while (pending() == true)
+    {
+        task task = next_task();
+
+        if (pending() == false)
+        {
+            __pool->dequeue(this);
+        }
+
+        task();
+    }
+
+    while (m_running != 0)
     {
-        m_jobs.front_item()->wait();
-        m_jobs.pop_front();
+        m_cond.wait();
     }
 }
 
-void jobs::queue_job(function_t job)
+jobs::~jobs()
+{
+    wait();
+
+    __pool->release_tasks(std::move(m_tasks));
+}
+
+jobs::jobs()
+  : m_tasks(__pool->acquire_tasks())
+  , m_priority(get_priority(current_context()))
+{
+}
+
+void jobs::queue_job(task&& job)
+{
+    m_tasks.push_back(std::move(job));
+    __pool->queue(this);
+}
+
+bool jobs::pending() const
 {
-    m_jobs.push_back();
-    m_jobs.back_item()->run(std::move(job));
+    return m_next_task != m_tasks.size();
 }
 
-jobs::jobs(jobs_t::entry_pool_t* entry_pool)
-  : m_jobs(entry_pool)
+task jobs::next_task()
 {
+    assert(likely(pending() == true));
+    return std::move(m_tasks[m_next_task++]);
 }
 
+void jobs::done()
+{
+    assert(likely(m_running != 0));
 
-thread_local std::unique_ptr<jobs_t::entry_pool_t> __entry_pool;
+    if (--m_running == 0)
+    {
+        m_cond.signal_all();
+    }
+}
 
 
 void initialize()
 {
-    __entry_pool = std::make_unique<jobs_t::entry_pool_t>();
+    initialize(default_max_workers);
+}
+
+void initialize(uint32_t max_workers)
+{
+    __pool = std::make_unique<pool>(max_workers);
+}
+
+void set_stack_size(stack_size size)
+{
+    __pool->set_stack_size(size);
 }
 
 jobs create_jobs()
 {
-    return jobs(__entry_pool.get());
+    return jobs();
 }
 
 }
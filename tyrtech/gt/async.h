@@ -1,58 +1,196 @@
 #pragma once
 
 
-#include <common/slab_list.h>
+#include <common/disallow_copy.h>
+#include <common/disallow_move.h>
+#include <common/branch_prediction.h>
 #include <gt/engine.h>
+#include <gt/condition.h>
+
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <vector>
+#include <type_traits>
 
 
 namespace tyrtech::gt::async {
 
 
-class job : private disallow_copy
+class task : private disallow_copy
 {
 public:
-    void run(function_t&& function);
-    void wait();
+    void operator()()
+    {
+        assert(likely(m_ops != nullptr));
+        m_ops->invoke(m_storage.data());
+    }
+
+public:
+    task() = default;
+
+    template<typename Function,
+             typename = std::enable_if_t<std::is_same_v<std::decay_t<Function>, task> == false>>
+    task(Function&& function)
+    {
+        using function_t =
+                std::decay_t<Function>;
+
+        using storage_t =
+                std::conditional_t<fits<function_t>, function_t, boxed<function_t>>;
+
+        new (m_storage.data()) storage_t(std::forward<Function>(function));
+        m_ops = &ops_for<storage_t>;
+    }
+
+    ~task()
+    {
+        reset();
+    }
+
+    task(task&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        reset();
+
+        if (other.m_ops != nullptr)
+        {
+            other.m_ops->move(other.m_storage.data(), m_storage.data());
+
+            m_ops = other.m_ops;
+            other.m_ops = nullptr;
+        }
+
+        return *this;
+    }
+
+private:
+    static constexpr size_t buffer_size{48};
 
 private:
-    context_queue_t m_wait_queue{new_context_queue()};
-    bool m_done{false};
+    struct ops
+    {
+        void (*invoke)(void*);
+        void (*move)(void*, void*);
+        void (*destroy)(void*);
+    };
+
+    template<typename Function>
+    struct boxed
+    {
+        std::unique_ptr<Function> function;
+
+        template<typename F>
+        boxed(F&& f)
+          : function(std::make_unique<Function>(std::forward<F>(f)))
+        {
+        }
+
+        void operator()()
+        {
+            (*function)();
+        }
+    };
+
+    template<typename Function>
+    static constexpr bool fits{sizeof(Function) <= buffer_size &&
+                               alignof(Function) <= alignof(std::max_align_t) &&
+                               std::is_nothrow_move_constructible_v<Function>};
+
+    template<typename T>
+    static constexpr ops ops_for{
+        [] (void* function)
+        {
+            (*static_cast<T*>(function))();
+        },
+        [] (void* from, void* to)
+        {
+            new (to) T(std::move(*static_cast<T*>(from)));
+            static_cast<T*>(from)->~T();
+        },
+        [] (void* function)
+        {
+            static_cast<T*>(function)->~T();
+        }
+    };
 
 private:
-    void signal();
+    alignas(std::max_align_t) std::array<char, buffer_size> m_storage;
+    const ops* m_ops{nullptr};
+
+private:
+    void reset()
+    {
+        if (m_ops != nullptr)
+        {
+            m_ops->destroy(m_storage.data());
+            m_ops = nullptr;
+        }
+    }
 };
 
 
-using jobs_t =
-        slab_list<job, 128>;
+using tasks_t =
+        std::vector<task>;
 
 
-class jobs : private disallow_copy
+class jobs : private disallow_copy, disallow_move
 {
 public:
     template<typename... Arguments>
     void run(Arguments&&... arguments)
     {
-        queue_job(std::bind(std::forward<Arguments>(arguments)...));
+        queue_job(task(std::bind(std::forward<Arguments>(arguments)...)));
     }
 
     void wait();
 
+public:
+    ~jobs();
+
 private:
-    jobs_t m_jobs;
+    tasks_t m_tasks;
+    uint32_t m_next_task{0};
+
+    uint32_t m_running{0};
+    condition m_cond;
+
+    priority m_priority{priority::normal};
+
+    jobs* m_prev{nullptr};
+    jobs* m_next{nullptr};
+
+    bool m_queued{false};
 
 private:
-    jobs(jobs_t::entry_pool_t* entry_pool);
+    jobs();
 
 private:
-    void queue_job(function_t job);
+    void queue_job(task&& job);
+
+    bool pending() const;
+    task next_task();
+
+    void done();
 
 private:
+    friend class pool;
     friend jobs create_jobs();
 };
 
 
+static constexpr uint32_t default_max_workers{64};
+
+
 void initialize();
+void initialize(uint32_t max_workers);
+
+void set_stack_size(stack_size size);
+
 jobs create_jobs();
 
 }
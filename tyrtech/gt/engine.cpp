@@ -1,13 +1,26 @@
 #include <common/disallow_copy.h>
 #include <common/disallow_move.h>
+#include <common/exception.h>
+#include <common/system_error.h>
 #include <gt/engine.h>
+#include <gt/timer.h>
 #include <extern/gtswitch.h>
 
+#include <sys/mman.h>
+
+#include <unordered_set>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
 
 namespace tyrtech::gt {
 
 
-static constexpr uint32_t stack_size{0x10000U};
+static constexpr uint32_t page_size{0x1000U};
+static constexpr uint32_t stacks_per_chunk{128};
+static constexpr char stack_pattern{static_cast<char>(0xa5)};
+static constexpr uint32_t max_stride{0x100000U};
 
 
 struct context : private disallow_copy, disallow_move
@@ -33,26 +46,103 @@ struct context : private disallow_copy, disallow_move
     state state{state::SUSPENDED};
     bool is_user_ctx{false};
 
-    uint32_t stack{static_cast<uint32_t>(-1)};
+    priority base_priority{priority::normal};
+    priority effective_priority{priority::normal};
+
+    std::array<uint32_t, priorities> boosts{{0}};
+    uint32_t run_entry{context_queue_t::invalid_handle};
+
+    char* stack{nullptr};
+    uint32_t stack_class{0};
+    bool guarded{false};
+    bool sampled{false};
+
     uint32_t ctx{static_cast<uint32_t>(-1)};
 
     void reset();
 };
 
+struct stacks : private disallow_copy, disallow_move
+{
+    using free_stacks_t =
+            std::vector<char*>;
+
+    using chunk_ptr =
+            std::unique_ptr<char[]>;
+
+    using chunks_t =
+            std::vector<chunk_ptr>;
+
+    using mappings_t =
+            std::vector<char*>;
+
+    uint32_t size{0};
+    bool guarded{false};
+
+    free_stacks_t free_stacks;
+    free_stacks_t free_guarded_stacks;
+
+    chunks_t chunks;
+    mappings_t mappings;
+
+    stack_stats stats;
+
+    char* allocate(bool guarded);
+    void free(char* stack, bool guarded);
+
+    void extend();
+    void map();
+
+    stacks(uint32_t size);
+    ~stacks();
+};
+
+struct run_class : private disallow_copy
+{
+    context_queue_t queue;
+
+    uint64_t pass{0};
+    uint32_t stride{0};
+
+    run_class(context_queue_t::entry_pool_t* entry_pool, uint32_t weight);
+    run_class(run_class&& other) noexcept = default;
+};
+
 struct engine : private disallow_copy, disallow_move
 {
-    using stack_pool_t =
-            slabs<std::array<char, stack_size>>;
+    using run_classes_t =
+            std::vector<run_class>;
+
+    using stacks_ptr =
+            std::unique_ptr<stacks>;
+
+    using stacks_t =
+            std::array<stacks_ptr, stack_sizes.size()>;
+
+    using sampled_contexts_t =
+            std::unordered_set<context_t>;
 
     using context_pool_t =
             slabs<context>;
 
+    using callbacks_t =
+            std::vector<function_t>;
+
     context_queue_t::entry_pool_t queue_entry_pool;
-    context_queue_t run_queue{&queue_entry_pool};
 
-    stack_pool_t stack_pool;
+    run_classes_t run_classes;
+
+    uint64_t runnable{0};
+    uint64_t pass{0};
+
+    stacks_t stacks;
     context_pool_t context_pool;
 
+    uint32_t sample_rate{default_stack_sample_rate};
+    uint64_t sample_counter{0};
+
+    sampled_contexts_t sampled_contexts;
+
     uint64_t suspended_ctx{0};
     uint64_t user_ctx{0};
     uint64_t user_ctx_waiting{0};
@@ -61,25 +151,40 @@ struct engine : private disallow_copy, disallow_move
     context_t current_ctx{&idle_ctx};
 
     bool terminated{false};
+    callbacks_t terminate_callbacks;
 
     void enqueue(context_t ctx);
+    void update_priority(context_t ctx);
     bool yield(bool enqueue_ctx);
 
-    context_t create_context(bool is_user_ctx, function_t thread_callback);
+    context_t create_context(bool is_user_ctx,
+                             stack_size size,
+                             priority prio,
+                             function_t thread_callback);
     context_t current_context() const;
 
+    void set_user_context(context_t ctx, bool is_user_ctx);
+    void terminate();
+
     context_queue_t new_context_queue();
 
     void switch_to_idle(bool enqueue_ctx);
     void switch_to_next(bool enqueue_ctx);
 
-    uint32_t allocate_stack();
-    void free_stack(uint32_t handle);
-    char* get_stack(uint32_t handle);
+    context_t next_context();
+    void push_runnable(context_t ctx);
+
+    void allocate_stack(context_t ctx, stack_size size);
+    void free_stack(context_t ctx);
+
+    void sample(context_t ctx);
+    stacks_stats_t stacks_stats();
 
     uint32_t allocate_context();
     void free_context(uint32_t handle);
     context_t get_context(uint32_t handle);
+
+    engine();
 };
 
 
@@ -105,7 +210,7 @@ void __start_thread(context_t ctx)
     ctx->reset();
 
     engine->free_context(ctx->ctx);
-    engine->free_stack(ctx->stack);
+    engine->free_stack(ctx);
 
     engine->current_ctx = &engine->idle_ctx;
     gtjump(engine->idle_ctx.registers.data());
@@ -117,6 +222,96 @@ void context::reset()
     terminate_callback = function_t();
 }
 
+char* stacks::allocate(bool guarded)
+{
+    auto&& free_list = (guarded == true) ? free_guarded_stacks : free_stacks;
+
+    if (unlikely(free_list.empty() == true))
+    {
+        if (guarded == true)
+        {
+            map();
+        }
+        else
+        {
+            extend();
+        }
+    }
+
+    char* stack = free_list.back();
+    free_list.pop_back();
+
+    assert(likely((reinterpret_cast<uint64_t>(stack) & 0x0f) == 0));
+
+    return stack;
+}
+
+void stacks::free(char* stack, bool guarded)
+{
+    if (guarded == true)
+    {
+        free_guarded_stacks.push_back(stack);
+    }
+    else
+    {
+        free_stacks.push_back(stack);
+    }
+}
+
+void stacks::extend()
+{
+    chunks.push_back(chunk_ptr(new char[size * stacks_per_chunk]));
+
+    for (uint32_t i = 0; i < stacks_per_chunk; i++)
+    {
+        free_stacks.push_back(chunks.back().get() + i * size);
+    }
+
+    stats.reserved += size * stacks_per_chunk;
+}
+
+void stacks::map()
+{
+    void* ptr = mmap(nullptr,
+                     size + page_size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                     -1,
+                     0);
+
+    if (unlikely(ptr == MAP_FAILED))
+    {
+        throw runtime_error("mmap(): {}", system_error().message);
+    }
+
+    char* mapping = static_cast<char*>(ptr);
+
+    if (unlikely(mprotect(mapping, page_size, PROT_NONE) == -1))
+    {
+        munmap(mapping, size + page_size);
+        throw runtime_error("mprotect(): {}", system_error().message);
+    }
+
+    mappings.push_back(mapping);
+    free_guarded_stacks.push_back(mapping + page_size);
+
+    stats.reserved += size;
+}
+
+stacks::stacks(uint32_t size)
+  : size(size)
+{
+    assert(likely((size & (page_size - 1)) == 0));
+}
+
+stacks::~stacks()
+{
+    for (auto&& mapping : mappings)
+    {
+        munmap(mapping, size + page_size);
+    }
+}
+
 void engine::enqueue(context_t ctx)
 {
     assert(likely(ctx->state == context::state::SUSPENDED));
@@ -130,12 +325,43 @@ void engine::enqueue(context_t ctx)
         user_ctx_waiting++;
     }
 
-    run_queue.push_back(ctx);
+    push_runnable(ctx);
+    runnable++;
+}
+
+void engine::update_priority(context_t ctx)
+{
+    priority prio = ctx->base_priority;
+
+    for (uint32_t i = 0; i < static_cast<uint32_t>(ctx->base_priority); i++)
+    {
+        if (ctx->boosts[i] != 0)
+        {
+            prio = static_cast<priority>(i);
+            break;
+        }
+    }
+
+    if (prio == ctx->effective_priority)
+    {
+        return;
+    }
+
+    if (ctx->state != context::state::WAITING)
+    {
+        ctx->effective_priority = prio;
+        return;
+    }
+
+    run_classes[static_cast<uint32_t>(ctx->effective_priority)].queue.erase(ctx->run_entry);
+
+    ctx->effective_priority = prio;
+    push_runnable(ctx);
 }
 
 bool engine::yield(bool enqueue_ctx)
 {
-    if (run_queue.empty() == true)
+    if (runnable == 0)
     {
         if (current_ctx != &idle_ctx)
         {
@@ -159,20 +385,22 @@ bool engine::yield(bool enqueue_ctx)
     return true;
 }
 
-context_t engine::create_context(bool is_user_ctx, function_t thread_callback)
+context_t engine::create_context(bool is_user_ctx,
+                                 stack_size size,
+                                 priority prio,
+                                 function_t thread_callback)
 {
-    assert(likely((stack_size & 0x0fff) == 0));
-
     uint32_t _ctx = allocate_context();
     context_t ctx = get_context(_ctx);
 
     ctx->ctx = _ctx;
-    ctx->stack = allocate_stack();
+    allocate_stack(ctx, size);
 
     ctx->engine = this;
     ctx->thread_callback = std::move(thread_callback);
 
-    char* stack = get_stack(ctx->stack);
+    char* stack = ctx->stack;
+    uint32_t stack_size = static_cast<uint32_t>(size);
 
     *reinterpret_cast<uint64_t*>(&stack[stack_size - 16]) =
             reinterpret_cast<uint64_t>(&__start_thread);
@@ -184,6 +412,10 @@ context_t engine::create_context(bool is_user_ctx, function_t thread_callback)
     ctx->state = context::state::SUSPENDED;
     ctx->is_user_ctx = is_user_ctx;
 
+    ctx->base_priority = prio;
+    ctx->effective_priority = prio;
+    ctx->boosts.fill(0);
+
     if (is_user_ctx == true)
     {
         user_ctx++;
@@ -196,6 +428,52 @@ context_t engine::create_context(bool is_user_ctx, function_t thread_callback)
     return ctx;
 }
 
+void engine::set_user_context(context_t ctx, bool is_user_ctx)
+{
+    if (ctx->is_user_ctx == is_user_ctx)
+    {
+        return;
+    }
+
+    ctx->is_user_ctx = is_user_ctx;
+
+    if (is_user_ctx == true)
+    {
+        user_ctx++;
+
+        if (ctx->state == context::state::WAITING)
+        {
+            user_ctx_waiting++;
+        }
+    }
+    else
+    {
+        assert(likely(user_ctx != 0));
+        user_ctx--;
+
+        if (ctx->state == context::state::WAITING)
+        {
+            assert(likely(user_ctx_waiting != 0));
+            user_ctx_waiting--;
+        }
+    }
+}
+
+void engine::terminate()
+{
+    if (terminated == true)
+    {
+        return;
+    }
+
+    terminated = true;
+
+    for (auto&& callback : terminate_callbacks)
+    {
+        callback();
+    }
+}
+
 context_queue_t engine::new_context_queue()
 {
     return context_queue_t(&queue_entry_pool);
@@ -233,9 +511,7 @@ void engine::switch_to_next(bool enqueue_ctx)
     }
 
     context_t old_ctx = current_ctx;
-    context_t new_ctx = *run_queue.front_item();
-
-    run_queue.pop_front();
+    context_t new_ctx = next_context();
 
     current_ctx = new_ctx;
     current_ctx->state = context::state::RUNNING;
@@ -249,27 +525,118 @@ void engine::switch_to_next(bool enqueue_ctx)
     gtswitch(old_ctx->registers.data(), new_ctx->registers.data());
 }
 
-uint32_t engine::allocate_stack()
+context_t engine::next_context()
 {
-    if (unlikely(stack_pool.full() == true))
+    run_class* next = nullptr;
+
+    for (auto&& rc : run_classes)
     {
-        stack_pool.extend(std::make_unique<stack_pool_t::slab>(128));
+        if (rc.queue.empty() == false && (next == nullptr || rc.pass < next->pass))
+        {
+            next = &rc;
+        }
     }
 
-    return stack_pool.allocate();
+    assert(likely(next != nullptr));
+
+    pass = next->pass;
+    next->pass += next->stride;
+
+    context_t ctx = *next->queue.front_item();
+    next->queue.pop_front();
+
+    ctx->run_entry = context_queue_t::invalid_handle;
+
+    assert(likely(runnable != 0));
+    runnable--;
+
+    return ctx;
 }
 
-void engine::free_stack(uint32_t handle)
+void engine::push_runnable(context_t ctx)
 {
-    stack_pool.free(handle);
+    auto&& rc = run_classes[static_cast<uint32_t>(ctx->effective_priority)];
+
+    if (rc.queue.empty() == true)
+    {
+        rc.pass = std::max(rc.pass, pass);
+    }
+
+    ctx->run_entry = rc.queue.push_back(ctx);
 }
 
-char* engine::get_stack(uint32_t handle)
+void engine::allocate_stack(context_t ctx, stack_size size)
 {
-    char* stack = stack_pool.get(handle).data();
-    assert(likely((reinterpret_cast<uint64_t>(stack) & 0x0f) == 0));
+    uint32_t stack_class = 0;
 
-    return stack;
+    while (stack_sizes[stack_class] != size)
+    {
+        stack_class++;
+        assert(likely(stack_class < stack_sizes.size()));
+    }
+
+    auto&& s = stacks[stack_class];
+
+    ctx->stack = s->allocate(s->guarded);
+    ctx->stack_class = stack_class;
+    ctx->guarded = s->guarded;
+
+    s->stats.contexts++;
+
+    if (sample_rate != 0 && ++sample_counter % sample_rate == 0)
+    {
+        std::memset(ctx->stack, stack_pattern, s->size);
+
+        ctx->sampled = true;
+        sampled_contexts.insert(ctx);
+
+        s->stats.sampled++;
+    }
+}
+
+void engine::free_stack(context_t ctx)
+{
+    if (ctx->sampled == true)
+    {
+        sample(ctx);
+
+        ctx->sampled = false;
+        sampled_contexts.erase(ctx);
+    }
+
+    stacks[ctx->stack_class]->free(ctx->stack, ctx->guarded);
+    ctx->stack = nullptr;
+}
+
+void engine::sample(context_t ctx)
+{
+    auto&& s = stacks[ctx->stack_class];
+
+    uint32_t unused = 0;
+
+    while (unused < s->size && ctx->stack[unused] == stack_pattern)
+    {
+        unused++;
+    }
+
+    s->stats.high_water_mark = std::max<uint64_t>(s->stats.high_water_mark, s->size - unused);
+}
+
+stacks_stats_t engine::stacks_stats()
+{
+    for (auto&& ctx : sampled_contexts)
+    {
+        sample(ctx);
+    }
+
+    stacks_stats_t stats;
+
+    for (uint32_t i = 0; i < stacks.size(); i++)
+    {
+        stats[i] = stacks[i]->stats;
+    }
+
+    return stats;
 }
 
 uint32_t engine::allocate_context()
@@ -292,6 +659,25 @@ context_t engine::get_context(uint32_t handle)
     return &context_pool.get(handle);
 }
 
+run_class::run_class(context_queue_t::entry_pool_t* entry_pool, uint32_t weight)
+  : queue(entry_pool)
+  , stride(max_stride / weight)
+{
+}
+
+engine::engine()
+{
+    for (auto&& weight : default_priority_weights)
+    {
+        run_classes.emplace_back(&queue_entry_pool, weight);
+    }
+
+    for (uint32_t i = 0; i < stacks.size(); i++)
+    {
+        stacks[i] = std::make_unique<struct stacks>(static_cast<uint32_t>(stack_sizes[i]));
+    }
+}
+
 
 thread_local std::unique_ptr<engine> __engine;
 
@@ -301,6 +687,30 @@ void initialize()
     __engine = std::make_unique<engine>();
 }
 
+void set_guarded_stacks(bool guarded_stacks)
+{
+    for (auto&& stacks : __engine->stacks)
+    {
+        stacks->guarded = guarded_stacks;
+    }
+}
+
+void set_stack_sample_rate(uint32_t rate)
+{
+    __engine->sample_rate = rate;
+}
+
+stacks_stats_t stacks_stats()
+{
+    return __engine->stacks_stats();
+}
+
+void set_priority_weight(priority prio, uint32_t weight)
+{
+    assert(likely(weight != 0));
+    __engine->run_classes[static_cast<uint32_t>(prio)].stride = max_stride / weight;
+}
+
 bool terminated()
 {
     return __engine->terminated;
@@ -308,7 +718,7 @@ bool terminated()
 
 void terminate()
 {
-    __engine->terminated = true;
+    __engine->terminate();
 }
 
 bool yield(bool enqueue_ctx)
@@ -331,10 +741,22 @@ uint64_t user_contexts()
     return __engine->user_ctx;
 }
 
+void set_user_context(context_t ctx, bool is_user_ctx)
+{
+    __engine->set_user_context(ctx, is_user_ctx);
+}
+
+void at_terminate(function_t callback)
+{
+    __engine->terminate_callbacks.push_back(std::move(callback));
+}
+
 void run()
 {
     while (true)
     {
+        run_timers();
+
         if (yield(false) == false)
         {
             break;
@@ -359,7 +781,51 @@ context_queue_t new_context_queue()
 
 context_t create_context(bool is_user_ctx, function_t thread_callback)
 {
-    return __engine->create_context(is_user_ctx, std::move(thread_callback));
+    return __engine->create_context(is_user_ctx,
+                                    stack_size::large,
+                                    __engine->current_ctx->base_priority,
+                                    std::move(thread_callback));
+}
+
+context_t create_context(bool is_user_ctx, stack_size size, function_t thread_callback)
+{
+    return __engine->create_context(is_user_ctx,
+                                    size,
+                                    __engine->current_ctx->base_priority,
+                                    std::move(thread_callback));
+}
+
+context_t create_context(bool is_user_ctx, priority prio, function_t thread_callback)
+{
+    return __engine->create_context(is_user_ctx,
+                                    stack_size::large,
+                                    prio,
+                                    std::move(thread_callback));
+}
+
+priority get_priority(context_t ctx)
+{
+    return ctx->effective_priority;
+}
+
+void set_priority(context_t ctx, priority prio)
+{
+    ctx->base_priority = prio;
+    __engine->update_priority(ctx);
+}
+
+void boost_priority(context_t ctx, priority prio)
+{
+    ctx->boosts[static_cast<uint32_t>(prio)]++;
+    __engine->update_priority(ctx);
+}
+
+void restore_priority(context_t ctx, priority prio)
+{
+    assert(likely(ctx->boosts[static_cast<uint32_t>(prio)] != 0));
+
+    ctx->boosts[static_cast<uint32_t>(prio)]--;
+    __engine->update_priority(ctx);
 }
 
 void _set_terminate_callback(context_t ctx, function_t terminate_callback)
@@ -4,6 +4,7 @@
 #include <common/slab_list.h>
 
 #include <functional>
+#include <array>
 
 
 namespace tyrtech::gt {
@@ -20,7 +21,57 @@ using context_queue_t =
         slab_list<context_t, 1024>;
 
 
+enum class stack_size : uint32_t
+{
+    small = 0x2000U,
+    medium = 0x4000U,
+    large = 0x10000U
+};
+
+
+static constexpr std::array<stack_size, 3> stack_sizes{{
+    stack_size::small,
+    stack_size::medium,
+    stack_size::large
+}};
+
+
+struct stack_stats
+{
+    uint64_t contexts{0};
+    uint64_t sampled{0};
+    uint64_t high_water_mark{0};
+    uint64_t reserved{0};
+};
+
+using stacks_stats_t =
+        std::array<stack_stats, stack_sizes.size()>;
+
+
+static constexpr uint32_t default_stack_sample_rate{0};
+
+
+enum class priority : uint32_t
+{
+    latency_critical = 0,
+    normal = 1,
+    background = 2
+};
+
+
+static constexpr uint32_t priorities{3};
+
+static constexpr std::array<uint32_t, priorities> default_priority_weights{{8, 4, 1}};
+
+
 void initialize();
+
+void set_guarded_stacks(bool guarded_stacks);
+void set_stack_sample_rate(uint32_t rate);
+stacks_stats_t stacks_stats();
+
+void set_priority_weight(priority prio, uint32_t weight);
+
 void terminate();
 
 void run();
@@ -33,12 +84,23 @@ int32_t sleep(uint64_t msec);
 
 context_t current_context();
 context_t create_context(bool is_user_ctx, function_t thread_callback);
+context_t create_context(bool is_user_ctx, stack_size size, function_t thread_callback);
+context_t create_context(bool is_user_ctx, priority prio, function_t thread_callback);
+
+priority get_priority(context_t ctx);
+void set_priority(context_t ctx, priority prio);
+
+void boost_priority(context_t ctx, priority prio);
+void restore_priority(context_t ctx, priority prio);
 
 context_queue_t new_context_queue();
 
 uint64_t user_contexts_waiting();
 uint64_t user_contexts();
 
+void set_user_context(context_t ctx, bool is_user_ctx);
+void at_terminate(function_t callback);
+
 void _set_terminate_callback(context_t ctx, function_t terminate_callback);
 
 template<typename... Arguments>
@@ -59,4 +121,28 @@ context_t create_system_thread(Arguments&&... arguments)
     return create_context(false, std::bind(std::forward<Arguments>(arguments)...));
 }
 
+template<typename... Arguments>
+context_t create_thread(stack_size size, Arguments&&... arguments)
+{
+    return create_context(true, size, std::bind(std::forward<Arguments>(arguments)...));
+}
+
+template<typename... Arguments>
+context_t create_system_thread(stack_size size, Arguments&&... arguments)
+{
+    return create_context(false, size, std::bind(std::forward<Arguments>(arguments)...));
+}
+
+template<typename... Arguments>
+context_t create_thread(priority prio, Arguments&&... arguments)
+{
+    return create_context(true, prio, std::bind(std::forward<Arguments>(arguments)...));
+}
+
+template<typename... Arguments>
+context_t create_system_thread(priority prio, Arguments&&... arguments)
+{
+    return create_context(false, prio, std::bind(std::forward<Arguments>(arguments)...));
+}
+
 }
@@ -1,5 +1,7 @@
 #include <gt/mutex.h>
 
+#include <algorithm>
+
 
 namespace tyrtech::gt {
 
@@ -12,11 +14,18 @@ void mutex::lock()
     }
     else
     {
+        priority prio = get_priority(current_context());
+
+        if (m_boosted == false || prio < m_boost)
+        {
+            restore_owner();
+            boost_owner(prio);
+        }
+
         m_wait_queue.push_back(current_context());
         yield(false);
 
-        assert(likely(m_owner == nullptr));
-        m_owner = current_context();
+        assert(likely(m_owner == current_context()));
     }
 }
 
@@ -24,13 +33,23 @@ void mutex::unlock()
 {
     assert(likely(m_owner == current_context()));
 
-    m_owner = nullptr;
+    restore_owner();
+
+    if (m_wait_queue.empty() == true)
+    {
+        m_owner = nullptr;
+        return;
+    }
+
+    m_owner = *m_wait_queue.front_item();
+    m_wait_queue.pop_front();
 
     if (m_wait_queue.empty() == false)
     {
-        enqueue(*m_wait_queue.front_item());
-        m_wait_queue.pop_front();
+        boost_owner(waiter_priority());
     }
+
+    enqueue(m_owner);
 }
 
 context_t mutex::owner() const
@@ -38,4 +57,41 @@ context_t mutex::owner() const
     return m_owner;
 }
 
+void mutex::boost_owner(priority prio)
+{
+    assert(likely(m_boosted == false));
+
+    boost_priority(m_owner, prio);
+
+    m_boost = prio;
+    m_boosted = true;
+}
+
+void mutex::restore_owner()
+{
+    if (m_boosted == false)
+    {
+        return;
+    }
+
+    restore_priority(m_owner, m_boost);
+
+    m_boosted = false;
+}
+
+priority mutex::waiter_priority()
+{
+    priority prio = priority::background;
+
+    uint32_t e = m_wait_queue.begin();
+
+    while (e != context_queue_t::invalid_handle)
+    {
+        prio = std::min(prio, get_priority(*m_wait_queue.item(e)));
+        e = m_wait_queue.next(e);
+    }
+
+    return prio;
+}
+
 }
@@ -17,6 +17,15 @@ public:
 private:
     context_t m_owner{nullptr};
     context_queue_t m_wait_queue{new_context_queue()};
+
+    priority m_boost{priority::normal};
+    bool m_boosted{false};
+
+private:
+    void boost_owner(priority prio);
+    void restore_owner();
+
+    priority waiter_priority();
 };
 
 }
@@ -0,0 +1,286 @@
+#include <common/branch_prediction.h>
+#include <common/clock.h>
+#include <gt/timer.h>
+
+#include <array>
+#include <algorithm>
+#include <cassert>
+
+
+namespace tyrtech::gt {
+
+
+class timer_wheel : private disallow_copy, disallow_move
+{
+public:
+    void add(timer* t, uint64_t msec);
+    void remove(timer* t);
+
+    void advance(uint64_t now);
+    uint64_t next() const;
+
+public:
+    timer_wheel();
+
+private:
+    static constexpr uint32_t slot_bits{6};
+    static constexpr uint32_t slots{1U << slot_bits};
+    static constexpr uint32_t levels{4};
+
+    static constexpr uint64_t max_delta{(1ULL << (slot_bits * levels)) - 1};
+
+private:
+    using slots_t =
+            std::array<timer*, slots>;
+
+    using wheel_t =
+            std::array<slots_t, levels>;
+
+    using bitmaps_t =
+            std::array<uint64_t, levels>;
+
+private:
+    wheel_t m_wheel{};
+    bitmaps_t m_bitmaps{};
+
+    uint64_t m_now{0};
+    uint64_t m_timers{0};
+
+private:
+    void place(timer* t);
+    void unlink(timer* t);
+
+    void tick();
+    void cascade(uint32_t level);
+    void expire(uint32_t slot);
+};
+
+
+void timer_wheel::add(timer* t, uint64_t msec)
+{
+    uint64_t now = clock::now() / 1000000;
+
+    if (m_timers == 0)
+    {
+        m_now = std::max(m_now, now);
+    }
+
+    t->m_deadline = std::max(now + msec, m_now + 1);
+    t->m_active = true;
+
+    place(t);
+
+    m_timers++;
+}
+
+void timer_wheel::remove(timer* t)
+{
+    unlink(t);
+
+    t->m_active = false;
+
+    assert(likely(m_timers != 0));
+    m_timers--;
+}
+
+void timer_wheel::advance(uint64_t now)
+{
+    while (m_now < now)
+    {
+        uint64_t next_event = next();
+
+        if (next_event > now)
+        {
+            m_now = now;
+            break;
+        }
+
+        m_now = std::max(m_now, next_event - 1);
+
+        tick();
+    }
+}
+
+uint64_t timer_wheel::next() const
+{
+    uint64_t next_event = no_timers;
+
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        uint64_t bitmap = m_bitmaps[level];
+
+        if (bitmap == 0)
+        {
+            continue;
+        }
+
+        uint32_t shift = slot_bits * level;
+        uint64_t current = m_now >> shift;
+
+        uint32_t offset = (current + 1) & (slots - 1);
+        uint64_t rotated = (bitmap >> offset) | (bitmap << ((slots - offset) & (slots - 1)));
+
+        uint64_t event = (current + 1 + __builtin_ctzll(rotated)) << shift;
+
+        next_event = std::min(next_event, event);
+    }
+
+    return next_event;
+}
+
+timer_wheel::timer_wheel()
+  : m_now(clock::now() / 1000000)
+{
+}
+
+void timer_wheel::place(timer* t)
+{
+    uint64_t deadline = std::min(t->m_deadline, m_now + max_delta);
+    uint64_t delta = deadline - m_now;
+
+    uint32_t level = 0;
+
+    while (delta >= (1ULL << (slot_bits * (level + 1))))
+    {
+        level++;
+    }
+
+    uint32_t slot = (deadline >> (slot_bits * level)) & (slots - 1);
+
+    t->m_level = level;
+    t->m_slot = slot;
+
+    t->m_prev = nullptr;
+    t->m_next = m_wheel[level][slot];
+
+    if (t->m_next != nullptr)
+    {
+        t->m_next->m_prev = t;
+    }
+
+    m_wheel[level][slot] = t;
+    m_bitmaps[level] |= 1ULL << slot;
+}
+
+void timer_wheel::unlink(timer* t)
+{
+    if (t->m_prev != nullptr)
+    {
+        t->m_prev->m_next = t->m_next;
+    }
+    else
+    {
+        m_wheel[t->m_level][t->m_slot] = t->m_next;
+    }
+
+    if (t->m_next != nullptr)
+    {
+        t->m_next->m_prev = t->m_prev;
+    }
+
+    if (m_wheel[t->m_level][t->m_slot] == nullptr)
+    {
+        m_bitmaps[t->m_level] &= ~(1ULL << t->m_slot);
+    }
+
+    t->m_prev = nullptr;
+    t->m_next = nullptr;
+}
+
+void timer_wheel::tick()
+{
+    m_now++;
+
+    for (uint32_t level = 1; level < levels; level++)
+    {
+        if ((m_now & ((1ULL << (slot_bits * level)) - 1)) != 0)
+        {
+            break;
+        }
+
+        cascade(level);
+    }
+
+    expire(m_now & (slots - 1));
+}
+
+void timer_wheel::cascade(uint32_t level)
+{
+    uint32_t slot = (m_now >> (slot_bits * level)) & (slots - 1);
+
+    while (m_wheel[level][slot] != nullptr)
+    {
+        timer* t = m_wheel[level][slot];
+
+        unlink(t);
+        place(t);
+    }
+}
+
+void timer_wheel::expire(uint32_t slot)
+{
+    while (m_wheel[0][slot] != nullptr)
+    {
+        timer* t = m_wheel[0][slot];
+
+        assert(likely(t->m_deadline <= m_now));
+
+        remove(t);
+
+        function_t callback = std::move(t->m_callback);
+        callback();
+    }
+}
+
+
+thread_local timer_wheel __timer_wheel;
+
+
+void timer::start(uint64_t msec, function_t callback)
+{
+    cancel();
+
+    m_callback = std::move(callback);
+    __timer_wheel.add(this, msec);
+}
+
+void timer::cancel()
+{
+    if (m_active == true)
+    {
+        __timer_wheel.remove(this);
+    }
+}
+
+bool timer::active() const
+{
+    return m_active;
+}
+
+timer::~timer()
+{
+    cancel();
+}
+
+
+void run_timers()
+{
+    __timer_wheel.advance(clock::now() / 1000000);
+}
+
+uint64_t next_timer()
+{
+    return __timer_wheel.next();
+}
+
+int32_t sleep(uint64_t msec)
+{
+    timer t;
+
+    t.start(msec, std::bind(&enqueue, current_context()));
+    yield(false);
+
+    return 0;
+}
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+
+#include <common/disallow_copy.h>
+#include <common/disallow_move.h>
+#include <gt/engine.h>
+
+
+namespace tyrtech::gt {
+
+
+class timer : private disallow_copy, disallow_move
+{
+public:
+    void start(uint64_t msec, function_t callback);
+    void cancel();
+
+    bool active() const;
+
+public:
+    timer() = default;
+    ~timer();
+
+private:
+    function_t m_callback;
+    uint64_t m_deadline{0};
+
+    timer* m_prev{nullptr};
+    timer* m_next{nullptr};
+
+    uint32_t m_level{0};
+    uint32_t m_slot{0};
+
+    bool m_active{false};
+
+private:
+    friend class timer_wheel;
+};
+
+
+static constexpr uint64_t no_timers{static_cast<uint64_t>(-1)};
+
+
+void run_timers();
+uint64_t next_timer();
+
+}
@@ -95,25 +95,20 @@ uint32_t channel::send(const char* data, uint32_t size, uint64_t timeout)
 
 void channel::send_all(const char* data, uint32_t size, uint64_t timeout)
 {
+    uint64_t deadline = clock::now() / 1000000 + timeout;
+
     while (size != 0)
     {
-        uint64_t t1 = clock::now();
-
         uint32_t res = send(data, size, timeout);
 
-        uint64_t send_took = clock::now() - t1;
+        data += res;
+        size -= res;
 
-        if (likely(timeout > send_took))
-        {
-            timeout -= send_took;
-        }
-        else
+        if (timeout != 0)
         {
-            timeout = 1;
+            uint64_t now = clock::now() / 1000000;
+            timeout = (deadline > now) ? deadline - now : 1;
         }
-
-        data += res;
-        size -= res;
     }
 }
 
@@ -6,11 +6,17 @@ namespace tyrtech::io {
 
 uint32_t channel_reader::read(char* data, uint32_t size)
 {
-    return m_channel->recv(data, size, 0);
+    return m_channel->recv(data, size, m_timeout);
 }
 
 channel_reader::channel_reader(channel* channel)
+  : channel_reader(channel, 0)
+{
+}
+
+channel_reader::channel_reader(channel* channel, uint64_t timeout)
   : m_channel(channel)
+  , m_timeout(timeout)
 {
 }
 
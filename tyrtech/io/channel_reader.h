@@ -17,9 +17,11 @@ public:
 
 public:
     channel_reader(channel* channel);
+    channel_reader(channel* channel, uint64_t timeout);
 
 private:
     channel* m_channel{nullptr};
+    uint64_t m_timeout{0};
 };
 
 }
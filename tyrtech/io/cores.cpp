@@ -0,0 +1,458 @@
+#include <common/disallow_copy.h>
+#include <common/disallow_move.h>
+#include <common/cpu_sched.h>
+#include <common/spsc_queue.h>
+#include <common/mpsc_queue.h>
+#include <common/system_error.h>
+#include <common/exception.h>
+#include <common/logger.h>
+#include <gt/async.h>
+#include <io/engine.h>
+#include <io/cores.h>
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+#include <exception>
+
+
+namespace tyrtech::io::cores {
+
+
+struct message : private disallow_copy, disallow_move
+{
+    gt::function_t function;
+    gt::context_t context{nullptr};
+
+    std::exception_ptr error;
+
+    uint32_t origin{0};
+    gt::priority priority{gt::priority::normal};
+
+    bool done{false};
+};
+
+
+class mailbox : private disallow_copy, disallow_move
+{
+public:
+    void push(uint32_t origin, message* msg);
+    void push(message* msg);
+
+    void mailbox_thread();
+
+public:
+    mailbox(uint32_t cores);
+    ~mailbox();
+
+private:
+    static constexpr uint32_t queue_size{1024};
+    static constexpr uint64_t poll_timeout{100};
+
+private:
+    using queue_t =
+            spsc_queue<message*, queue_size>;
+
+    using queue_ptr =
+            std::unique_ptr<queue_t>;
+
+    using queues_t =
+            std::vector<queue_ptr>;
+
+    using external_queue_t =
+            mpsc_queue<message*, queue_size>;
+
+private:
+    queues_t m_queues;
+    external_queue_t m_external_queue;
+
+    std::atomic<bool> m_waiting{false};
+    int32_t m_fd{-1};
+
+private:
+    void wake();
+    uint32_t drain();
+
+    void process(message* msg);
+    void execute(message* msg);
+};
+
+
+struct runtime
+{
+    using mailbox_ptr =
+            std::unique_ptr<mailbox>;
+
+    using mailboxes_t =
+            std::vector<mailbox_ptr>;
+
+    mailboxes_t mailboxes;
+
+    std::atomic<uint64_t> in_flight{0};
+    std::atomic<uint64_t> activity{0};
+    std::atomic<uint32_t> idle_cores{0};
+};
+
+
+static constexpr uint32_t invalid_core{static_cast<uint32_t>(-1)};
+static constexpr uint64_t idle_check_interval{10};
+
+
+std::unique_ptr<runtime> __runtime;
+
+thread_local uint32_t __core{invalid_core};
+thread_local bool __idle{false};
+
+
+void set_idle(bool idle)
+{
+    if (__idle == idle)
+    {
+        return;
+    }
+
+    __idle = idle;
+
+    if (idle == true)
+    {
+        __runtime->idle_cores++;
+    }
+    else
+    {
+        __runtime->idle_cores--;
+    }
+}
+
+void send(uint32_t core, message* msg)
+{
+    assert(likely(core < __runtime->mailboxes.size()));
+
+    __runtime->in_flight++;
+    __runtime->activity++;
+
+    if (__core != invalid_core)
+    {
+        __runtime->mailboxes[core]->push(__core, msg);
+    }
+    else
+    {
+        __runtime->mailboxes[core]->push(msg);
+    }
+}
+
+void complete()
+{
+    __runtime->activity++;
+    __runtime->in_flight--;
+}
+
+bool quiescent()
+{
+    uint64_t activity = __runtime->activity.load();
+
+    if (__runtime->idle_cores.load() != __runtime->mailboxes.size())
+    {
+        return false;
+    }
+
+    if (__runtime->in_flight.load() != 0)
+    {
+        return false;
+    }
+
+    return activity == __runtime->activity.load();
+}
+
+void keepalive_thread()
+{
+    while (true)
+    {
+        set_idle(gt::user_contexts() == 1);
+
+        if (__idle == true && quiescent() == true)
+        {
+            break;
+        }
+
+        gt::sleep(idle_check_interval);
+    }
+}
+
+void run_core(uint32_t core, int32_t cpu, const main_t& main)
+{
+    set_cpu(cpu);
+
+    __core = core;
+
+    gt::initialize();
+    gt::async::initialize();
+
+    gt::create_system_thread(&mailbox::mailbox_thread, __runtime->mailboxes[core].get());
+    gt::create_thread(&keepalive_thread);
+
+    main(core);
+}
+
+
+void mailbox::push(uint32_t origin, message* msg)
+{
+    auto&& queue = m_queues[origin];
+
+    while (queue->push(msg) == false)
+    {
+        wake();
+        gt::yield();
+    }
+
+    wake();
+}
+
+void mailbox::push(message* msg)
+{
+    while (m_external_queue.push(msg) == false)
+    {
+        wake();
+        std::this_thread::yield();
+    }
+
+    wake();
+}
+
+void mailbox::mailbox_thread()
+{
+    while (true)
+    {
+        if (drain() != 0)
+        {
+            gt::yield();
+            continue;
+        }
+
+        if (gt::terminated() == true)
+        {
+            break;
+        }
+
+        m_waiting.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (drain() == 0)
+        {
+            auto res = io::poll(m_fd, POLLIN, poll_timeout);
+
+            if (unlikely(res == -1 && errno != ECANCELED))
+            {
+                throw runtime_error("poll(): {}", system_error().message);
+            }
+        }
+
+        m_waiting.store(false);
+
+        uint64_t value;
+
+        if (unlikely(::read(m_fd, &value, sizeof(value)) == -1 && errno != EAGAIN))
+        {
+            throw runtime_error("read(): {}", system_error().message);
+        }
+    }
+}
+
+mailbox::mailbox(uint32_t cores)
+{
+    for (uint32_t i = 0; i < cores; i++)
+    {
+        m_queues.push_back(std::make_unique<queue_t>());
+    }
+
+    m_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (unlikely(m_fd == -1))
+    {
+        throw runtime_error("eventfd(): {}", system_error().message);
+    }
+}
+
+mailbox::~mailbox()
+{
+    ::close(m_fd);
+}
+
+void mailbox::wake()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_waiting.load(std::memory_order_relaxed) == false)
+    {
+        return;
+    }
+
+    uint64_t value = 1;
+
+    if (unlikely(::write(m_fd, &value, sizeof(value)) == -1 && errno != EAGAIN))
+    {
+        throw runtime_error("write(): {}", system_error().message);
+    }
+}
+
+uint32_t mailbox::drain()
+{
+    uint32_t count = 0;
+    message* msg;
+
+    for (auto&& queue : m_queues)
+    {
+        while (queue->pop(&msg) == true)
+        {
+            process(msg);
+            count++;
+        }
+    }
+
+    while (m_external_queue.pop(&msg) == true)
+    {
+        process(msg);
+        count++;
+    }
+
+    return count;
+}
+
+void mailbox::process(message* msg)
+{
+    if (msg->done == true)
+    {
+        gt::enqueue(msg->context);
+        complete();
+
+        return;
+    }
+
+    set_idle(false);
+
+    gt::create_thread(msg->priority, &mailbox::execute, this, msg);
+}
+
+void mailbox::execute(message* msg)
+{
+    std::unique_ptr<message> posted;
+
+    if (msg->context == nullptr)
+    {
+        posted.reset(msg);
+    }
+
+    try
+    {
+        msg->function();
+    }
+    catch (std::exception& e)
+    {
+        if (posted != nullptr)
+        {
+            logger::error("core {}: {}", __core, e.what());
+        }
+        else
+        {
+            msg->error = std::current_exception();
+        }
+    }
+
+    if (posted == nullptr)
+    {
+        msg->done = true;
+        send(msg->origin, msg);
+    }
+
+    complete();
+}
+
+
+void run(const cpus_t& cpus, const main_t& main)
+{
+    assert(likely(cpus.empty() == false));
+    assert(likely(__runtime == nullptr));
+
+    __runtime = std::make_unique<runtime>();
+
+    for (uint32_t i = 0; i < cpus.size(); i++)
+    {
+        __runtime->mailboxes.push_back(std::make_unique<mailbox>(cpus.size()));
+    }
+
+    std::vector<std::thread> threads;
+
+    for (uint32_t core = 1; core < cpus.size(); core++)
+    {
+        threads.emplace_back(&run_core, core, cpus[core], std::cref(main));
+    }
+
+    run_core(0, cpus[0], main);
+
+    for (auto&& thread : threads)
+    {
+        thread.join();
+    }
+
+    __runtime.reset();
+}
+
+uint32_t current()
+{
+    assert(likely(__core != invalid_core));
+    return __core;
+}
+
+uint32_t count()
+{
+    assert(likely(__runtime != nullptr));
+    return __runtime->mailboxes.size();
+}
+
+void post(uint32_t core, gt::function_t function)
+{
+    auto msg = std::make_unique<message>();
+
+    msg->function = std::move(function);
+    msg->origin = __core;
+
+    if (__core != invalid_core)
+    {
+        msg->priority = gt::get_priority(gt::current_context());
+    }
+
+    send(core, msg.release());
+}
+
+void call(uint32_t core, gt::function_t function)
+{
+    assert(likely(__core != invalid_core));
+
+    if (core == __core)
+    {
+        function();
+        return;
+    }
+
+    message msg;
+
+    msg.function = std::move(function);
+    msg.context = gt::current_context();
+    msg.origin = __core;
+    msg.priority = gt::get_priority(msg.context);
+
+    send(core, &msg);
+
+    gt::yield(false);
+
+    assert(likely(msg.done == true));
+
+    if (msg.error != nullptr)
+    {
+        std::rethrow_exception(msg.error);
+    }
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+
+#include <gt/engine.h>
+
+#include <vector>
+
+
+namespace tyrtech::io::cores {
+
+
+using cpus_t =
+        std::vector<int32_t>;
+
+using main_t =
+        std::function<void(uint32_t)>;
+
+
+void run(const cpus_t& cpus, const main_t& main);
+
+uint32_t current();
+uint32_t count();
+
+void post(uint32_t core, gt::function_t function);
+void call(uint32_t core, gt::function_t function);
+
+}
@@ -11,6 +11,9 @@ namespace tyrtech::io {
 
 
 void initialize(uint32_t queue_size);
+void initialize(uint32_t queue_size, bool sqpoll);
+
+void initialize_storage(uint32_t queue_size, bool sqpoll, bool iopoll);
 
 int32_t pread(int32_t fd, void* buffer, uint32_t size, int64_t offset);
 int32_t pwrite(int32_t fd, const void* buffer, uint32_t size, int64_t offset);
@@ -24,6 +27,8 @@ int32_t recv(int32_t fd, char* buffer, uint32_t size, int32_t flags, uint64_t ti
 int32_t accept(int32_t fd, sockaddr* address, uint32_t* address_size, uint64_t timeout);
 int32_t connect(int32_t fd, const sockaddr* address, uint32_t address_size, uint64_t timeout);
 
+int32_t poll(int32_t fd, uint32_t events, uint64_t timeout);
+
 int32_t allocate(int32_t fd, int32_t mode, uint64_t offset, uint64_t size);
 int32_t close(int32_t fd);
 
@@ -31,4 +36,10 @@ int32_t sync(int32_t fd, uint32_t flags);
 
 int32_t nop();
 
+int32_t register_buffers(const iovec* iov, uint32_t size);
+int32_t unregister_buffers();
+
+int32_t register_file(int32_t fd);
+int32_t unregister_file(int32_t fd);
+
 }
@@ -7,6 +7,7 @@
 #include <io/queue_flow.h>
 
 #include <sys/file.h>
+#include <linux/io_uring.h>
 #include <fcntl.h>
 #include <unistd.h>
 
@@ -116,6 +117,18 @@ void file::allocate(int32_t mode, uint64_t offset, uint64_t size)
     }
 }
 
+void file::sync()
+{
+    queue_flow::resource r(*__queue_flow);
+
+    auto res = io::sync(m_fd, IORING_FSYNC_DATASYNC);
+
+    if (unlikely(res == -1))
+    {
+        throw error("{}: {}", m_path, system_error().message);
+    }
+}
+
 struct stat64 file::stat()
 {
     struct stat64 stat;
@@ -143,6 +156,30 @@ bool file::try_lock()
     return true;
 }
 
+void file::set_direct_io(bool direct_io)
+{
+    int32_t flags = ::fcntl(m_fd, F_GETFL);
+
+    if (unlikely(flags == -1))
+    {
+        throw error("{}: {}", m_path, system_error().message);
+    }
+
+    if (direct_io == true)
+    {
+        flags |= O_DIRECT;
+    }
+    else
+    {
+        flags &= ~O_DIRECT;
+    }
+
+    if (auto res = ::fcntl(m_fd, F_SETFL, flags); unlikely(res == -1))
+    {
+        throw error("{}: {}", m_path, system_error().message);
+    }
+}
+
 void file::unlink()
 {
     if (auto res = ::unlink(m_path); unlikely(res == -1))
@@ -90,10 +90,14 @@ public:
     uint32_t pwritev(uint64_t offset, iovec* iov, uint32_t size);
 
     void allocate(int32_t mode, uint64_t offset, uint64_t size);
+    void sync();
+
     struct stat64 stat();
 
     bool try_lock();
 
+    void set_direct_io(bool direct_io);
+
     void unlink();
 
     std::string_view path() const;
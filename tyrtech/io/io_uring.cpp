@@ -2,15 +2,24 @@
 #include <common/disallow_move.h>
 #include <common/system_error.h>
 #include <common/exception.h>
+#include <common/clock.h>
 #include <gt/engine.h>
 #include <gt/condition.h>
+#include <gt/timer.h>
 #include <io/engine.h>
 #include <io/queue_flow.h>
 
 #include <sys/file.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
 #include <limits.h>
+#include <unistd.h>
 #include <liburing.h>
 
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
 
 namespace tyrtech::io::io_uring {
 
@@ -19,29 +28,145 @@ struct request
 {
     gt::context_t context{gt::current_context()};
     int32_t res{-1};
+
+    bool waiting{false};
+    bool completed{false};
+    bool timed_out{false};
+};
+
+struct wakeup : public request
+{
+    __kernel_timespec ts;
+    uint64_t deadline{0};
+
+    bool removing{false};
+
+    wakeup()
+    {
+        context = nullptr;
+    }
+};
+
+struct peer_event : public request
+{
+    uint64_t events{0};
+    bool armed{false};
+
+    peer_event()
+    {
+        context = nullptr;
+    }
 };
 
 class engine : private disallow_copy, disallow_move
 {
 public:
     io_uring_sqe* get_sqe();
+    io_uring_sqe* try_get_sqe();
+
+    uint32_t sqe_flags() const;
+
+    void set_peer(engine* peer);
+    void watch(engine* peer);
+
+    int32_t event_fd();
+
+    int32_t register_buffers(const iovec* iov, uint32_t size);
+    int32_t unregister_buffers();
+
+    int32_t register_file(int32_t fd);
+    int32_t unregister_file(int32_t fd);
+
+    int32_t buffer_index(const void* data, uint32_t size) const;
+    int32_t file_index(int32_t fd) const;
 
 public:
-    engine(uint32_t queue_size);
+    engine(uint32_t queue_size, bool sqpoll, bool iopoll, bool timers);
     ~engine();
 
+private:
+    static constexpr uint32_t max_files{64};
+    static constexpr uint32_t sq_thread_idle{100};
+
+private:
+    struct buffer
+    {
+        uint64_t start{0};
+        uint64_t end{0};
+        int32_t index{-1};
+    };
+
+    using buffers_t =
+            std::vector<buffer>;
+
+    using files_t =
+            std::vector<int32_t>;
+
+    using wakeup_ptr =
+            std::unique_ptr<wakeup>;
+
+    using wakeups_t =
+            std::vector<wakeup_ptr>;
+
 private:
     queue_flow m_queue_flow;
     ::io_uring m_io_uring;
 
+    bool m_polled{false};
+    bool m_iopoll{false};
+    bool m_timers{false};
+
+    engine* m_peer{nullptr};
+
+    int32_t m_event_fd{-1};
+    int32_t m_peer_fd{-1};
+
+    peer_event m_peer_event;
+
+    buffers_t m_buffers;
+
+    files_t m_files;
+    files_t m_file_slots;
+
+    bool m_files_registered{false};
+
+    wakeups_t m_wakeups;
+    wakeups_t m_spare_wakeups;
+
 private:
     void io_uring_thread();
+    void poll_completions();
+
+    void complete(request* req, int32_t res);
+
+    bool arm_peer_event();
+
+    void arm_wakeup();
+    void remove_wakeups();
+    void disarm(wakeup* w);
 };
 
-engine::engine(uint32_t queue_size)
+engine::engine(uint32_t queue_size, bool sqpoll, bool iopoll, bool timers)
   : m_queue_flow(queue_size)
+  , m_polled(sqpoll == true || iopoll == true)
+  , m_iopoll(iopoll)
+  , m_timers(timers)
 {
-    auto res = io_uring_queue_init(queue_size, &m_io_uring, 0);
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    if (sqpoll == true)
+    {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = sq_thread_idle;
+    }
+
+    if (iopoll == true)
+    {
+        params.flags |= IORING_SETUP_IOPOLL;
+    }
+
+    auto res = io_uring_queue_init_params(queue_size, &m_io_uring, &params);
 
     if (unlikely(res < 0))
     {
@@ -54,6 +179,11 @@ engine::engine(uint32_t queue_size)
 engine::~engine()
 {
     io_uring_queue_exit(&m_io_uring);
+
+    if (m_event_fd != -1)
+    {
+        close(m_event_fd);
+    }
 }
 
 io_uring_sqe* engine::get_sqe()
@@ -66,12 +196,218 @@ io_uring_sqe* engine::get_sqe()
     return sqe;
 }
 
+io_uring_sqe* engine::try_get_sqe()
+{
+    if (m_queue_flow.full() == true)
+    {
+        return nullptr;
+    }
+
+    return get_sqe();
+}
+
+uint32_t engine::sqe_flags() const
+{
+    return m_polled == true ? 0 : IOSQE_ASYNC;
+}
+
+void engine::set_peer(engine* peer)
+{
+    m_peer = peer;
+}
+
+void engine::watch(engine* peer)
+{
+    m_peer = peer;
+    m_peer_fd = peer->event_fd();
+}
+
+int32_t engine::event_fd()
+{
+    if (m_event_fd != -1 || m_iopoll == true)
+    {
+        return m_event_fd;
+    }
+
+    int32_t fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (unlikely(fd == -1))
+    {
+        throw runtime_error("eventfd(): {}", system_error().message);
+    }
+
+    if (auto res = io_uring_register_eventfd(&m_io_uring, fd); unlikely(res < 0))
+    {
+        close(fd);
+        throw runtime_error("io_uring_register_eventfd(): {}", system_error(-res).message);
+    }
+
+    m_event_fd = fd;
+
+    return m_event_fd;
+}
+
+int32_t engine::register_buffers(const iovec* iov, uint32_t size)
+{
+    if (m_buffers.size() != 0)
+    {
+        if (auto res = unregister_buffers(); unlikely(res < 0))
+        {
+            return res;
+        }
+    }
+
+    if (auto res = io_uring_register_buffers(&m_io_uring, iov, size); unlikely(res < 0))
+    {
+        return res;
+    }
+
+    for (uint32_t i = 0; i < size; i++)
+    {
+        buffer b;
+
+        b.start = reinterpret_cast<uint64_t>(iov[i].iov_base);
+        b.end = b.start + iov[i].iov_len;
+        b.index = i;
+
+        m_buffers.push_back(b);
+    }
+
+    std::sort(m_buffers.begin(),
+              m_buffers.end(),
+              [] (const buffer& b1, const buffer& b2)
+              {
+                  return b1.start < b2.start;
+              });
+
+    return 0;
+}
+
+int32_t engine::unregister_buffers()
+{
+    if (m_buffers.size() == 0)
+    {
+        return 0;
+    }
+
+    m_buffers.clear();
+
+    return io_uring_unregister_buffers(&m_io_uring);
+}
+
+int32_t engine::register_file(int32_t fd)
+{
+    assert(likely(fd >= 0));
+
+    if (m_files_registered == false)
+    {
+        files_t files(max_files, -1);
+
+        if (auto res = io_uring_register_files(&m_io_uring, files.data(), files.size()); unlikely(res < 0))
+        {
+            return res;
+        }
+
+        m_files_registered = true;
+    }
+
+    auto it = std::find(m_files.begin(), m_files.end(), -1);
+
+    if (it == m_files.end())
+    {
+        if (m_files.size() == max_files)
+        {
+            return -ENFILE;
+        }
+
+        it = m_files.insert(m_files.end(), -1);
+    }
+
+    int32_t slot = it - m_files.begin();
+
+    if (auto res = io_uring_register_files_update(&m_io_uring, slot, &fd, 1); unlikely(res < 0))
+    {
+        return res;
+    }
+
+    *it = fd;
+
+    if (static_cast<uint32_t>(fd) >= m_file_slots.size())
+    {
+        m_file_slots.resize(fd + 1, -1);
+    }
+
+    m_file_slots[fd] = slot;
+
+    return 0;
+}
+
+int32_t engine::unregister_file(int32_t fd)
+{
+    int32_t slot = file_index(fd);
+
+    if (slot == -1)
+    {
+        return 0;
+    }
+
+    m_file_slots[fd] = -1;
+    m_files[slot] = -1;
+
+    int32_t empty = -1;
+
+    return io_uring_register_files_update(&m_io_uring, slot, &empty, 1);
+}
+
+int32_t engine::buffer_index(const void* data, uint32_t size) const
+{
+    uint64_t start = reinterpret_cast<uint64_t>(data);
+
+    auto it = std::upper_bound(m_buffers.begin(),
+                               m_buffers.end(),
+                               start,
+                               [] (uint64_t start, const buffer& b)
+                               {
+                                   return start < b.start;
+                               });
+
+    if (it == m_buffers.begin())
+    {
+        return -1;
+    }
+
+    --it;
+
+    if (start + size > it->end)
+    {
+        return -1;
+    }
+
+    return it->index;
+}
+
+int32_t engine::file_index(int32_t fd) const
+{
+    if (static_cast<uint32_t>(fd) >= m_file_slots.size())
+    {
+        return -1;
+    }
+
+    return m_file_slots[fd];
+}
+
 void engine::io_uring_thread()
 {
     uint32_t last_enqueued = 0;
 
     while (true)
     {
+        if (m_timers == true)
+        {
+            gt::run_timers();
+            arm_wakeup();
+        }
+
         if (unlikely(m_queue_flow.enqueued() == 0))
         {
             if (unlikely(gt::terminated() == true))
@@ -81,7 +417,19 @@ void engine::io_uring_thread()
         }
         else
         {
-            uint32_t sleep = (gt::user_contexts_waiting() > 0) ? 0 : 1;
+            uint32_t sleep = 1;
+
+            if (gt::user_contexts_waiting() > 0)
+            {
+                sleep = 0;
+            }
+            else if (m_peer != nullptr && m_peer->m_queue_flow.enqueued() != 0)
+            {
+                if (arm_peer_event() == false)
+                {
+                    sleep = 0;
+                }
+            }
 
             if (last_enqueued != m_queue_flow.enqueued() || sleep == 1)
             {
@@ -93,6 +441,10 @@ void engine::io_uring_thread()
                                         system_error(-res).message);
                 }
             }
+            else if (m_iopoll == true)
+            {
+                poll_completions();
+            }
 
             io_uring_cqe* cqe;
 
@@ -105,8 +457,18 @@ void engine::io_uring_thread()
 
                 if (req != nullptr)
                 {
-                    req->res = cqe->res;
-                    enqueue(req->context);
+                    if (req->context != nullptr)
+                    {
+                        complete(req, cqe->res);
+                    }
+                    else if (req == &m_peer_event)
+                    {
+                        m_peer_event.armed = false;
+                    }
+                    else
+                    {
+                        disarm(static_cast<wakeup*>(req));
+                    }
                 }
 
                 count++;
@@ -122,6 +484,155 @@ void engine::io_uring_thread()
     }
 }
 
+void engine::poll_completions()
+{
+    auto res = syscall(__NR_io_uring_enter, m_io_uring.ring_fd, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+    if (unlikely(res < 0 && errno != EAGAIN && errno != EINTR))
+    {
+        throw runtime_error("io_uring_enter(): {}", system_error().message);
+    }
+}
+
+void engine::complete(request* req, int32_t res)
+{
+    req->res = res;
+    req->completed = true;
+
+    if (req->waiting == true)
+    {
+        req->waiting = false;
+        gt::enqueue(req->context);
+    }
+}
+
+bool engine::arm_peer_event()
+{
+    if (m_peer_fd == -1)
+    {
+        return false;
+    }
+
+    if (io_uring_sq_ready(&m_peer->m_io_uring) != 0)
+    {
+        auto res = io_uring_submit(&m_peer->m_io_uring);
+
+        if (unlikely(res < 0))
+        {
+            throw runtime_error("io_uring_submit(): {}", system_error(-res).message);
+        }
+    }
+
+    if (m_peer_event.armed == true)
+    {
+        return true;
+    }
+
+    io_uring_sqe* sqe = try_get_sqe();
+
+    if (sqe == nullptr)
+    {
+        return false;
+    }
+
+    io_uring_prep_read(sqe, m_peer_fd, &m_peer_event.events, sizeof(m_peer_event.events), 0);
+    io_uring_sqe_set_data(sqe, &m_peer_event);
+
+    m_peer_event.armed = true;
+
+    return true;
+}
+
+void engine::arm_wakeup()
+{
+    uint64_t deadline = gt::next_timer();
+
+    if (deadline == gt::no_timers)
+    {
+        if (gt::terminated() == true)
+        {
+            remove_wakeups();
+        }
+
+        return;
+    }
+
+    for (auto&& w : m_wakeups)
+    {
+        if (w->removing == false && w->deadline <= deadline)
+        {
+            return;
+        }
+    }
+
+    io_uring_sqe* sqe = try_get_sqe();
+
+    if (sqe == nullptr)
+    {
+        return;
+    }
+
+    if (m_spare_wakeups.empty() == true)
+    {
+        m_spare_wakeups.push_back(std::make_unique<wakeup>());
+    }
+
+    m_wakeups.push_back(std::move(m_spare_wakeups.back()));
+    m_spare_wakeups.pop_back();
+
+    wakeup* w = m_wakeups.back().get();
+
+    uint64_t now = clock::now() / 1000000;
+    uint64_t delay = (deadline > now) ? deadline - now : 0;
+
+    w->ts.tv_sec = static_cast<int64_t>(delay / 1000);
+    w->ts.tv_nsec = static_cast<int64_t>((delay % 1000) * 1000000);
+
+    w->deadline = deadline;
+    w->removing = false;
+
+    io_uring_prep_timeout(sqe, &w->ts, 0, 0);
+    io_uring_sqe_set_data(sqe, w);
+}
+
+void engine::remove_wakeups()
+{
+    for (auto&& w : m_wakeups)
+    {
+        if (w->removing == true)
+        {
+            continue;
+        }
+
+        io_uring_sqe* sqe = try_get_sqe();
+
+        if (sqe == nullptr)
+        {
+            return;
+        }
+
+        io_uring_prep_timeout_remove(sqe, reinterpret_cast<uint64_t>(w.get()), 0);
+        io_uring_sqe_set_data(sqe, nullptr);
+
+        w->removing = true;
+    }
+}
+
+void engine::disarm(wakeup* w)
+{
+    auto it = std::find_if(m_wakeups.begin(),
+                           m_wakeups.end(),
+                           [w] (const wakeup_ptr& armed)
+                           {
+                               return armed.get() == w;
+                           });
+
+    assert(likely(it != m_wakeups.end()));
+
+    m_spare_wakeups.push_back(std::move(*it));
+    m_wakeups.erase(it);
+}
+
 }
 
 
@@ -129,11 +640,47 @@ namespace tyrtech::io {
 
 
 thread_local std::unique_ptr<io_uring::engine> __io_uring;
+thread_local std::unique_ptr<io_uring::engine> __storage_io_uring;
 
 
 void initialize(uint32_t queue_size)
 {
-    __io_uring = std::make_unique<io_uring::engine>(queue_size);
+    initialize(queue_size, false);
+}
+
+void initialize(uint32_t queue_size, bool sqpoll)
+{
+    __io_uring = std::make_unique<io_uring::engine>(queue_size, sqpoll, false, true);
+}
+
+void initialize_storage(uint32_t queue_size, bool sqpoll, bool iopoll)
+{
+    assert(likely(__io_uring != nullptr));
+
+    __storage_io_uring = std::make_unique<io_uring::engine>(queue_size, sqpoll, iopoll, false);
+
+    __io_uring->watch(__storage_io_uring.get());
+    __storage_io_uring->set_peer(__io_uring.get());
+}
+
+io_uring::engine* storage_engine()
+{
+    if (__storage_io_uring != nullptr)
+    {
+        return __storage_io_uring.get();
+    }
+
+    return __io_uring.get();
+}
+
+io_uring::engine* engine_for(int32_t fd)
+{
+    if (__storage_io_uring != nullptr && __storage_io_uring->file_index(fd) != -1)
+    {
+        return __storage_io_uring.get();
+    }
+
+    return __io_uring.get();
 }
 
 io_uring_sqe* get_sqe()
@@ -141,53 +688,162 @@ io_uring_sqe* get_sqe()
     return __io_uring->get_sqe();
 }
 
-void add_timeout_to(io_uring_sqe* sqe, uint64_t timeout)
+int32_t to_result(int32_t res)
 {
-    sqe->flags |= IOSQE_IO_LINK;
+    if (unlikely(res < 0))
+    {
+        errno = -res;
+        return -1;
+    }
 
-    timeout *= 1000000;
+    return res;
+}
 
-    __kernel_timespec ts;
+int32_t register_buffers(const iovec* iov, uint32_t size)
+{
+    return to_result(storage_engine()->register_buffers(iov, size));
+}
+
+int32_t unregister_buffers()
+{
+    return to_result(storage_engine()->unregister_buffers());
+}
 
-    ts.tv_sec = static_cast<int64_t>(timeout / 1000000000);
-    ts.tv_nsec = static_cast<int64_t>(timeout % 1000000000);
+int32_t register_file(int32_t fd)
+{
+    return to_result(storage_engine()->register_file(fd));
+}
 
-    io_uring_prep_link_timeout(get_sqe(), &ts, 0);
+int32_t unregister_file(int32_t fd)
+{
+    return to_result(storage_engine()->unregister_file(fd));
+}
+
+void use_fixed_file(io_uring::engine* engine, io_uring_sqe* sqe, int32_t fd)
+{
+    if (int32_t index = engine->file_index(fd); index != -1)
+    {
+        sqe->fd = index;
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
 }
 
 int32_t wait_for(io_uring::request* request)
 {
+    request->waiting = true;
     gt::yield(false);
 
-    if (unlikely(request->res < 0))
+    return to_result(request->res);
+}
+
+void expire(io_uring::request* request)
+{
+    if (request->waiting == false)
     {
-        errno = -request->res;
-        return -1;
+        return;
+    }
+
+    request->waiting = false;
+    request->timed_out = true;
+
+    gt::enqueue(request->context);
+}
+
+int32_t wait_for(io_uring::request* request, uint64_t timeout)
+{
+    if (timeout == 0)
+    {
+        return wait_for(request);
+    }
+
+    gt::timer timer;
+    timer.start(timeout, std::bind(&expire, request));
+
+    request->waiting = true;
+    gt::yield(false);
+
+    timer.cancel();
+
+    if (request->completed == false)
+    {
+        io_uring_sqe* sqe = get_sqe();
+
+        io_uring_prep_cancel(sqe, request, 0);
+        io_uring_sqe_set_data(sqe, nullptr);
+
+        while (request->completed == false)
+        {
+            request->waiting = true;
+            gt::yield(false);
+        }
+    }
+
+    if (request->timed_out == true && request->res == -EINTR)
+    {
+        request->res = -ECANCELED;
     }
 
-    return request->res;
+    return to_result(request->res);
 }
 
 int32_t preadv(int32_t fd, iovec* iov, uint32_t size, int64_t offset)
 {
+    io_uring::engine* engine = engine_for(fd);
+
     io_uring::request request;
-    io_uring_sqe* sqe = get_sqe();
+    io_uring_sqe* sqe = engine->get_sqe();
+
+    int32_t index = -1;
+
+    if (size == 1)
+    {
+        index = engine->buffer_index(iov[0].iov_base, iov[0].iov_len);
+    }
+
+    if (index != -1)
+    {
+        io_uring_prep_read_fixed(sqe, fd, iov[0].iov_base, iov[0].iov_len, offset, index);
+    }
+    else
+    {
+        io_uring_prep_readv(sqe, fd, iov, size, offset);
+    }
 
-    io_uring_prep_readv(sqe, fd, iov, size, offset);
     io_uring_sqe_set_data(sqe, &request);
-    io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
+    io_uring_sqe_set_flags(sqe, engine->sqe_flags());
+
+    use_fixed_file(engine, sqe, fd);
 
     return wait_for(&request);
 }
 
 int32_t pwritev(int32_t fd, iovec* iov, uint32_t size, int64_t offset)
 {
+    io_uring::engine* engine = engine_for(fd);
+
     io_uring::request request;
-    io_uring_sqe* sqe = get_sqe();
+    io_uring_sqe* sqe = engine->get_sqe();
+
+    int32_t index = -1;
+
+    if (size == 1)
+    {
+        index = engine->buffer_index(iov[0].iov_base, iov[0].iov_len);
+    }
+
+    if (index != -1)
+    {
+        io_uring_prep_write_fixed(sqe, fd, iov[0].iov_base, iov[0].iov_len, offset, index);
+    }
+    else
+    {
+        io_uring_prep_writev(sqe, fd, iov, size, offset);
+    }
 
-    io_uring_prep_writev(sqe, fd, iov, size, offset);
     io_uring_sqe_set_data(sqe, &request);
-    io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
+    io_uring_sqe_set_flags(sqe, engine->sqe_flags());
+
+    use_fixed_file(engine, sqe, fd);
 
     return wait_for(&request);
 }
@@ -220,12 +876,7 @@ int32_t send(int32_t fd, const char* buffer, uint32_t size, int32_t flags, uint6
     io_uring_prep_send(sqe, fd, buffer, size, flags);
     io_uring_sqe_set_data(sqe, &request);
 
-    if (timeout != 0)
-    {
-        add_timeout_to(sqe, timeout);
-    }
-
-    return wait_for(&request);
+    return wait_for(&request, timeout);
 }
 
 int32_t recv(int32_t fd, char* buffer, uint32_t size, int32_t flags, uint64_t timeout)
@@ -237,12 +888,7 @@ int32_t recv(int32_t fd, char* buffer, uint32_t size, int32_t flags, uint64_t ti
     io_uring_sqe_set_data(sqe, &request);
     io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
 
-    if (timeout != 0)
-    {
-        add_timeout_to(sqe, timeout);
-    }
-
-    return wait_for(&request);
+    return wait_for(&request, timeout);
 }
 
 int32_t accept(int32_t fd, sockaddr* address, uint32_t* address_size, uint64_t timeout)
@@ -254,12 +900,7 @@ int32_t accept(int32_t fd, sockaddr* address, uint32_t* address_size, uint64_t t
     io_uring_sqe_set_data(sqe, &request);
     io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
 
-    if (timeout != 0)
-    {
-        add_timeout_to(sqe, timeout);
-    }
-
-    return wait_for(&request);
+    return wait_for(&request, timeout);
 }
 
 int32_t connect(int32_t fd, const sockaddr* address, uint32_t address_size, uint64_t timeout)
@@ -271,12 +912,18 @@ int32_t connect(int32_t fd, const sockaddr* address, uint32_t address_size, uint
     io_uring_sqe_set_data(sqe, &request);
     io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
 
-    if (timeout != 0)
-    {
-        add_timeout_to(sqe, timeout);
-    }
+    return wait_for(&request, timeout);
+}
 
-    return wait_for(&request);
+int32_t poll(int32_t fd, uint32_t events, uint64_t timeout)
+{
+    io_uring::request request;
+    io_uring_sqe* sqe = get_sqe();
+
+    io_uring_prep_poll_add(sqe, fd, events);
+    io_uring_sqe_set_data(sqe, &request);
+
+    return wait_for(&request, timeout);
 }
 
 int32_t allocate(int32_t fd, int32_t mode, uint64_t offset, uint64_t size)
@@ -293,6 +940,11 @@ int32_t allocate(int32_t fd, int32_t mode, uint64_t offset, uint64_t size)
 
 int32_t close(int32_t fd)
 {
+    if (auto res = storage_engine()->unregister_file(fd); unlikely(res < 0))
+    {
+        return to_result(res);
+    }
+
     io_uring::request request;
     io_uring_sqe* sqe = get_sqe();
 
@@ -311,6 +963,8 @@ int32_t sync(int32_t fd, uint32_t flags)
     io_uring_sqe_set_data(sqe, &request);
     io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
 
+    use_fixed_file(__io_uring.get(), sqe, fd);
+
     return wait_for(&request);
 }
 
@@ -327,27 +981,3 @@ int32_t nop()
 
 }
 
-
-namespace tyrtech::gt {
-
-
-int32_t sleep(uint64_t msec)
-{
-    msec *= 1000000;
-
-    __kernel_timespec ts;
-
-    ts.tv_sec = static_cast<int64_t>(msec / 1000000000);
-    ts.tv_nsec = static_cast<int64_t>(msec % 1000000000);
-
-    io::io_uring::request request;
-    io_uring_sqe* sqe = io::get_sqe();
-
-    io_uring_prep_timeout(sqe, &ts, 0, 0);
-    io_uring_sqe_set_data(sqe, &request);
-    io_uring_sqe_set_flags(sqe, IOSQE_ASYNC);
-
-    return io::wait_for(&request);
-}
-
-}
@@ -38,6 +38,11 @@ uint32_t queue_flow::enqueued() const
     return m_enqueued;
 }
 
+bool queue_flow::full() const
+{
+    return m_enqueued == m_queue_size;
+}
+
 queue_flow::queue_flow(uint32_t queue_size)
   : m_queue_size(queue_size)
 {
@@ -26,6 +26,7 @@ public:
     void release(uint32_t count = 1);
 
     uint32_t enqueued() const;
+    bool full() const;
 
 public:
     queue_flow(uint32_t queue_size);
@@ -37,8 +37,14 @@ public:
 
 public:
     rpc_server(std::shared_ptr<io::channel> channel, T* service)
+      : rpc_server(std::move(channel), service, 0)
+    {
+    }
+
+    rpc_server(std::shared_ptr<io::channel> channel, T* service, uint64_t idle_timeout)
       : m_channel(std::move(channel))
       , m_service(service)
+      , m_idle_timeout(idle_timeout)
     {
         gt::create_thread(&rpc_server::server_thread, this);
     }
@@ -62,6 +68,8 @@ private:
 
     T* m_service{nullptr};
 
+    uint64_t m_idle_timeout{0};
+
 private:
     void server_thread()
     {
@@ -97,7 +105,7 @@ private:
         try
         {
             buffer_t recv_buffer;
-            io::channel_reader channel_reader(remote.get());
+            io::channel_reader channel_reader(remote.get(), m_idle_timeout);
 
             reader_t reader(&recv_buffer, &channel_reader);
 
@@ -149,6 +157,10 @@ private:
         {
             logger::debug("{}: disconnected", remote->uri());
         }
+        catch (io::channel::timeout_error&)
+        {
+            logger::debug("{}: idle timeout, disconnecting...", remote->uri());
+        }
         catch (message::malformed_message_error&)
         {
             logger::error("{}: invalid message, disconnecting...", remote->uri());
@@ -1,3 +1,6 @@
+#include <common/logger.h>
+#include <common/system_error.h>
+#include <io/engine.h>
 #include <storage/common.h>
 #include <storage/cache.h>
 
@@ -40,6 +43,11 @@ uint32_t cache::get(uint64_t cache_key)
     return m_cache.get(cache_key);
 }
 
+bool cache::contains(uint64_t cache_key)
+{
+    return m_cache.contains(cache_key);
+}
+
 char* cache::get_memory(uint32_t page)
 {
     uint16_t buffer_ndx = m_pages.slab_index(page);
@@ -63,6 +71,23 @@ cache::cache(uint32_t cache_bits)
         m_buffers.push_back(std::make_unique<aligned_buffer>(buffer_alignment, part_size));
         m_pages.extend(std::make_unique<pages_t::slab>(part_size >> page_bits));
     }
+
+    std::vector<iovec> iov;
+
+    for (auto&& buffer : m_buffers)
+    {
+        iov.push_back(iovec{buffer->data(), buffer->size()});
+    }
+
+    if (io::register_buffers(iov.data(), iov.size()) == -1)
+    {
+        logger::warning("unable to register cache buffers: {}", system_error().message);
+    }
+}
+
+cache::~cache()
+{
+    io::unregister_buffers();
 }
 
 }
@@ -17,11 +17,13 @@ public:
 
     void add(uint64_t cache_key, uint32_t page);
     uint32_t get(uint64_t cache_key);
+    bool contains(uint64_t cache_key);
 
     char* get_memory(uint32_t page);
 
 public:
     cache(uint32_t cache_bits);
+    ~cache();
 
 private:
     static constexpr uint32_t buffer_alignment{4096};
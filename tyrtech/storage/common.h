@@ -13,6 +13,10 @@ static constexpr uint32_t page_size{1 << page_bits};
 static constexpr uint32_t page_mask{page_size - 1};
 
 static constexpr uint32_t file_pages_bits{25};
+static constexpr uint32_t file_pages_mask{(1U << file_pages_bits) - 1};
+
+static constexpr uint32_t max_devices{1U << (32 - file_pages_bits)};
+static constexpr uint32_t stripe_pages{256};
 
 static constexpr uint32_t invalid_handle{static_cast<uint32_t>(-1)};
 
@@ -21,6 +25,29 @@ using extents_t =
         std::vector<uint64_t>;
 
 
+inline uint64_t make_extent(uint32_t device, uint32_t page, uint32_t pages)
+{
+    return (static_cast<uint64_t>(page) << 32) |
+           (static_cast<uint64_t>(device) << file_pages_bits) |
+           pages;
+}
+
+inline uint32_t extent_device(uint64_t extent)
+{
+    return (extent & 0xffffffffU) >> file_pages_bits;
+}
+
+inline uint32_t extent_page(uint64_t extent)
+{
+    return extent >> 32;
+}
+
+inline uint32_t extent_pages(uint64_t extent)
+{
+    return extent & file_pages_mask;
+}
+
+
 struct file_descriptor
 {
     uint64_t cache_id{0};
@@ -0,0 +1,304 @@
+#include <common/aligned_buffer.h>
+#include <common/logger.h>
+#include <storage/defragmenter.h>
+
+#include <algorithm>
+
+
+namespace tyrtech::storage {
+
+
+thread_local uint32_t threshold{defragmenter::default_threshold};
+thread_local uint64_t rate{defragmenter::default_rate};
+
+
+void defragmenter::set_threshold(uint32_t extents)
+{
+    threshold = extents;
+}
+
+void defragmenter::set_rate(uint64_t bytes)
+{
+    rate = bytes;
+}
+
+uint32_t defragmenter::defragment()
+{
+    if (m_active == true)
+    {
+        return 0;
+    }
+
+    m_active = true;
+
+    using candidates_t =
+            std::vector<std::pair<uint32_t, uint64_t>>;
+
+    candidates_t candidates;
+
+    for (auto&& it : m_manifest->files())
+    {
+        auto& descriptor = it.second.descriptor;
+
+        if (fragmented(descriptor) == true)
+        {
+            candidates.emplace_back(descriptor.extents.size(), descriptor.cache_id);
+        }
+    }
+
+    std::sort(candidates.rbegin(), candidates.rend());
+
+    uint32_t relocated = 0;
+
+    try
+    {
+        for (auto&& candidate : candidates)
+        {
+            if (gt::terminated() == true)
+            {
+                break;
+            }
+
+            if (relocate(candidate.second) == true)
+            {
+                relocated++;
+            }
+        }
+    }
+    catch (exception&)
+    {
+        m_active = false;
+        throw;
+    }
+
+    m_active = false;
+
+    return relocated;
+}
+
+void defragmenter::start(uint64_t interval)
+{
+    if (m_running == true)
+    {
+        return;
+    }
+
+    m_running = true;
+
+    gt::create_system_thread(gt::priority::background,
+                             &defragmenter::defragment_thread,
+                             this,
+                             interval);
+}
+
+fragmentation_stats defragmenter::stats() const
+{
+    fragmentation_stats stats;
+
+    m_disk->histogram(&stats.free_ranges);
+
+    for (auto&& it : m_manifest->files())
+    {
+        uint32_t extents = it.second.descriptor.extents.size();
+        uint32_t bucket = 31 - __builtin_clz(std::max(extents, 1U));
+
+        if (stats.file_extents.size() <= bucket)
+        {
+            stats.file_extents.resize(bucket + 1);
+        }
+
+        stats.file_extents[bucket]++;
+    }
+
+    stats.relocated_files = m_relocated_files;
+    stats.relocated_pages = m_relocated_pages;
+
+    return stats;
+}
+
+defragmenter::defragmenter(disk* disk, disk_reader* reader, manifest* manifest)
+  : m_disk(disk)
+  , m_reader(reader)
+  , m_manifest(manifest)
+{
+}
+
+bool defragmenter::fragmented(const file_descriptor& descriptor) const
+{
+    uint32_t pages = 0;
+
+    for (auto&& extent : descriptor.extents)
+    {
+        pages += extent_pages(extent);
+    }
+
+    return descriptor.extents.size() > m_disk->stripes(pages) + threshold;
+}
+
+bool defragmenter::relocate(uint64_t cache_id)
+{
+    auto it = m_manifest->files().find(cache_id);
+
+    if (it == m_manifest->files().end())
+    {
+        return false;
+    }
+
+    uint64_t owner = it->second.owner;
+    file_descriptor descriptor = it->second.descriptor;
+
+    if (m_reader->contains(cache_id, descriptor.extents) == false)
+    {
+        return false;
+    }
+
+    uint32_t pages = 0;
+
+    for (auto&& extent : descriptor.extents)
+    {
+        pages += extent_pages(extent);
+    }
+
+    extents_t new_extents;
+    m_disk->allocate(pages, &new_extents);
+
+    bool copied = false;
+
+    try
+    {
+        copied = copy(cache_id, descriptor.extents, new_extents);
+    }
+    catch (exception& e)
+    {
+        logger::error("{}", e.what());
+    }
+
+    it = m_manifest->files().find(cache_id);
+
+    if (copied == false ||
+        it == m_manifest->files().end() ||
+        it->second.descriptor.extents != descriptor.extents ||
+        m_reader->relocate(cache_id, descriptor.extents, new_extents) == false)
+    {
+        m_disk->remove(new_extents);
+        return false;
+    }
+
+    extents_t extents = std::move(descriptor.extents);
+    descriptor.extents = std::move(new_extents);
+
+    m_manifest->add(owner, descriptor);
+    m_manifest->commit();
+
+    m_reader->wait_for_reads();
+    m_disk->remove(extents);
+
+    m_relocated_files++;
+    m_relocated_pages += pages;
+
+    return true;
+}
+
+bool defragmenter::copy(uint64_t cache_id, const extents_t& extents, const extents_t& new_extents)
+{
+    aligned_buffer buffer(page_size, copy_pages << page_bits);
+
+    auto src = extents.begin();
+    uint32_t src_offset = 0;
+
+    auto dst = new_extents.begin();
+    uint32_t dst_offset = 0;
+
+    while (src != extents.end())
+    {
+        if (m_reader->contains(cache_id, extents) == false)
+        {
+            return false;
+        }
+
+        assert(likely(dst != new_extents.end()));
+
+        uint32_t pages = std::min({extent_pages(*src) - src_offset,
+                                   extent_pages(*dst) - dst_offset,
+                                   copy_pages});
+
+        iovec iov;
+
+        iov.iov_base = buffer.data();
+        iov.iov_len = pages << page_bits;
+
+        uint32_t src_device = extent_device(*src);
+        uint32_t dst_device = extent_device(*dst);
+
+        if (m_disk->read(src_device, extent_page(*src) + src_offset, &iov, 1) != iov.iov_len)
+        {
+            throw disk::error("{}: unable to read", m_disk->path(src_device));
+        }
+
+        if (m_disk->write(dst_device, extent_page(*dst) + dst_offset, &iov, 1) != iov.iov_len)
+        {
+            throw disk::error("{}: unable to write", m_disk->path(dst_device));
+        }
+
+        src_offset += pages;
+
+        if (src_offset == extent_pages(*src))
+        {
+            ++src;
+            src_offset = 0;
+        }
+
+        dst_offset += pages;
+
+        if (dst != new_extents.end() && dst_offset == extent_pages(*dst))
+        {
+            ++dst;
+            dst_offset = 0;
+        }
+
+        throttle(pages);
+    }
+
+    return true;
+}
+
+void defragmenter::throttle(uint32_t pages)
+{
+    if (rate == 0)
+    {
+        return;
+    }
+
+    m_delay += (static_cast<uint64_t>(pages) << page_bits) * 1000;
+
+    if (m_delay >= rate)
+    {
+        gt::sleep(m_delay / rate);
+        m_delay %= rate;
+    }
+}
+
+void defragmenter::defragment_thread(uint64_t interval)
+{
+    while (gt::terminated() == false)
+    {
+        try
+        {
+            defragment();
+        }
+        catch (exception& e)
+        {
+            logger::error("{}, defragmenter stopped", e.what());
+            break;
+        }
+
+        for (uint64_t slept = 0; slept < interval && gt::terminated() == false; slept += 100)
+        {
+            gt::sleep(100);
+        }
+    }
+
+    m_running = false;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+
+#include <storage/disk_reader.h>
+#include <storage/manifest.h>
+
+
+namespace tyrtech::storage {
+
+
+struct fragmentation_stats
+{
+    using histogram_t =
+            std::vector<uint64_t>;
+
+    histogram_t free_ranges;
+    histogram_t file_extents;
+
+    uint64_t relocated_files{0};
+    uint64_t relocated_pages{0};
+};
+
+
+class defragmenter : private disallow_copy
+{
+public:
+    static constexpr uint32_t default_threshold{8};
+    static constexpr uint64_t default_rate{16UL << 20};
+
+public:
+    static void set_threshold(uint32_t extents);
+    static void set_rate(uint64_t bytes);
+
+public:
+    uint32_t defragment();
+    void start(uint64_t interval);
+
+    fragmentation_stats stats() const;
+
+public:
+    defragmenter(disk* disk, disk_reader* reader, manifest* manifest);
+
+private:
+    static constexpr uint32_t copy_pages{stripe_pages};
+
+private:
+    disk* m_disk{nullptr};
+    disk_reader* m_reader{nullptr};
+    manifest* m_manifest{nullptr};
+
+    bool m_active{false};
+    bool m_running{false};
+
+    uint64_t m_delay{0};
+
+    uint64_t m_relocated_files{0};
+    uint64_t m_relocated_pages{0};
+
+private:
+    bool fragmented(const file_descriptor& descriptor) const;
+    bool relocate(uint64_t cache_id);
+
+    bool copy(uint64_t cache_id, const extents_t& extents, const extents_t& new_extents);
+    void throttle(uint32_t pages);
+
+    void defragment_thread(uint64_t interval);
+};
+
+}
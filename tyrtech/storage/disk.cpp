@@ -1,66 +1,286 @@
+#include <common/branch_prediction.h>
+#include <common/logger.h>
 #include <common/system_error.h>
+#include <io/engine.h>
 #include <storage/disk.h>
 
 #include <mutex>
+#include <algorithm>
+#include <cassert>
+#include <fcntl.h>
 #include <sys/mount.h>
 
 
 namespace tyrtech::storage {
 
 
-void disk::read(uint32_t page, char* buff)
+thread_local uint64_t discard_rate{disk::default_discard_rate};
+
+
+void disk::read(uint32_t device, uint32_t page, char* buff)
 {
-    m_file.pread(static_cast<uint64_t>(page) << page_bits, buff, page_size);
+    assert(likely(device < m_devices.size()));
+    assert(likely((reinterpret_cast<uint64_t>(buff) & page_mask) == 0));
+
+    m_devices[device]->file.pread(static_cast<uint64_t>(page) << page_bits, buff, page_size);
+}
+
+uint32_t disk::read(uint32_t device, uint32_t page, iovec* iovec, uint32_t size)
+{
+    assert(likely(device < m_devices.size()));
+
+    return m_devices[device]->file.preadv(static_cast<uint64_t>(page) << page_bits, iovec, size);
 }
 
-uint32_t disk::write(uint32_t page, iovec* iovec, uint32_t size)
+uint32_t disk::write(uint32_t device, uint32_t page, iovec* iovec, uint32_t size)
 {
-    return m_file.pwritev(static_cast<uint64_t>(page) << page_bits, iovec, size);
+    assert(likely(device < m_devices.size()));
+
+    return m_devices[device]->file.pwritev(static_cast<uint64_t>(page) << page_bits, iovec, size);
+}
+
+uint64_t disk::allocate(uint32_t pages)
+{
+    assert(likely(pages <= file_pages_mask));
+
+    uint32_t next_device = m_next_device;
+    m_next_device = (m_next_device + 1) % m_devices.size();
+
+    for (uint32_t i = 0; i < m_devices.size(); i++)
+    {
+        uint32_t device = (next_device + i) % m_devices.size();
+
+        auto& blocks = m_devices[device]->blocks;
+        uint32_t page = blocks.allocate(pages);
+
+        while (unlikely(page == invalid_handle))
+        {
+            if (m_devices[device]->discards.empty() == false)
+            {
+                release_discards(m_devices[device].get());
+            }
+            else if (m_devices[device]->block_device == true)
+            {
+                break;
+            }
+            else
+            {
+                allocate_space(m_devices[device].get());
+            }
+
+            page = blocks.allocate(pages);
+        }
+
+        if (page != invalid_handle)
+        {
+            return make_extent(device, page, pages);
+        }
+    }
+
+    auto& blocks = m_devices[next_device]->blocks;
+    uint32_t page = blocks.allocate(pages);
+
+    while (unlikely(page == invalid_handle))
+    {
+        allocate_space(m_devices[next_device].get());
+        page = blocks.allocate(pages);
+    }
+
+    return make_extent(next_device, page, pages);
 }
 
-uint32_t disk::allocate(uint32_t pages)
+void disk::allocate(uint32_t pages, extents_t* extents)
 {
-    uint32_t block_page = m_blocks.allocate(pages);
+    uint32_t stripe = pages;
 
-    while (unlikely(block_page == invalid_handle))
+    if (m_devices.size() > 1)
     {
-        allocate_space();
+        stripe = stripe_pages;
+    }
 
-        block_page = m_blocks.allocate(pages);
+    uint32_t count = extents->size();
+
+    try
+    {
+        for (uint32_t allocated = 0; allocated < pages;)
+        {
+            uint64_t extent = allocate(std::min(stripe, pages - allocated));
+
+            extents->push_back(extent);
+            allocated += extent_pages(extent);
+        }
     }
+    catch (exception&)
+    {
+        extents_t allocated(extents->begin() + count, extents->end());
+        extents->resize(count);
 
-    return block_page;
+        remove(allocated);
+
+        throw;
+    }
 }
 
-void disk::free(uint32_t page, uint32_t pages)
+uint32_t disk::stripes(uint32_t pages) const
 {
-    m_blocks.free(page, pages);
+    if (m_devices.size() == 1)
+    {
+        return 1;
+    }
+
+    return (pages + stripe_pages - 1) / stripe_pages;
+}
+
+void disk::free(uint32_t device, uint32_t page, uint32_t pages)
+{
+    assert(likely(device < m_devices.size()));
+
+    if (m_devices[device]->discard_enabled == true && pages != 0)
+    {
+        queue_discard(m_devices[device].get(), page, pages);
+    }
+    else
+    {
+        m_devices[device]->blocks.free(page, pages);
+    }
 }
 
 void disk::remove(const extents_t& extents)
 {
     for (auto&& extent : extents)
     {
-        uint32_t extent_page = extent >> 32;
-        uint32_t extent_pages = extent & 0xffffffffU;
+        free(extent_device(extent), extent_page(extent), extent_pages(extent));
+    }
+}
 
-        free(extent_page, extent_pages);
+bool disk::reserve(uint32_t device, uint32_t page, uint32_t pages)
+{
+    if (device >= m_devices.size())
+    {
+        return false;
+    }
+
+    auto& blocks = m_devices[device]->blocks;
+
+    if (blocks.capacity() < page + pages)
+    {
+        blocks.extend(page + pages - blocks.capacity());
+    }
+
+    return blocks.reserve(page, pages);
+}
+
+void disk::reserve_cache_id(uint64_t cache_id)
+{
+    m_next_cache_id = std::max(m_next_cache_id, cache_id + 1);
+}
+
+void disk::sync()
+{
+    if (m_devices.size() == 1)
+    {
+        m_devices[0]->file.sync();
+    }
+    else
+    {
+        uint32_t pending = m_devices.size();
+        bool failed = false;
+
+        gt::condition cond;
+
+        for (auto&& device : m_devices)
+        {
+            gt::create_thread(&disk::sync_device, this, device.get(), &pending, &failed, &cond);
+        }
+
+        while (pending != 0)
+        {
+            cond.wait();
+        }
+
+        if (failed == true)
+        {
+            throw error("{}: unable to sync", path());
+        }
+    }
+
+    m_sync_epoch++;
+
+    for (auto&& device : m_devices)
+    {
+        if (device->discards.empty() == true || device->discard_active == true)
+        {
+            continue;
+        }
+
+        device->discard_active = true;
+
+        gt::create_system_thread(gt::priority::background,
+                                 &disk::discard_thread,
+                                 this,
+                                 device.get());
     }
 }
 
 uint32_t disk::size() const
 {
-    return m_blocks.size();
+    uint32_t size = 0;
+
+    for (auto&& device : m_devices)
+    {
+        size += device->blocks.size();
+
+        for (auto&& it : device->discards)
+        {
+            size -= it.second.pages;
+        }
+    }
+
+    return size;
 }
 
 uint32_t disk::capacity() const
 {
-    return m_blocks.capacity();
+    uint32_t capacity = 0;
+
+    for (auto&& device : m_devices)
+    {
+        capacity += device->blocks.capacity();
+    }
+
+    return capacity;
+}
+
+uint32_t disk::capacity(uint32_t device) const
+{
+    assert(likely(device < m_devices.size()));
+
+    return m_devices[device]->blocks.capacity();
+}
+
+uint32_t disk::devices() const
+{
+    return m_devices.size();
+}
+
+void disk::histogram(std::vector<uint64_t>* free_ranges) const
+{
+    for (auto&& device : m_devices)
+    {
+        device->blocks.histogram(free_ranges);
+    }
 }
 
 std::string_view disk::path() const
 {
-    return m_file.path();
+    return path(0);
+}
+
+std::string_view disk::path(uint32_t device) const
+{
+    assert(likely(device < m_devices.size()));
+
+    return m_devices[device]->file.path();
 }
 
 uint64_t disk::new_cache_id()
@@ -68,64 +288,220 @@ uint64_t disk::new_cache_id()
     return m_next_cache_id++;
 }
 
-disk::disk(io::file file, bool preallocate_space)
-  : m_file(std::move(file))
-  , m_preallocate_space(preallocate_space)
+void disk::set_discard_rate(uint64_t bytes)
+{
+    discard_rate = bytes;
+}
+
+disk::disk(io::file file, bool preallocate_space, bool direct_io)
+{
+    add_device(std::move(file), preallocate_space, direct_io);
+}
+
+disk::disk(std::vector<io::file> files, bool preallocate_space, bool direct_io)
+{
+    if (files.size() == 0 || files.size() > max_devices)
+    {
+        throw error("invalid number of devices: {}", files.size());
+    }
+
+    for (auto&& file : files)
+    {
+        add_device(std::move(file), preallocate_space, direct_io);
+    }
+}
+
+void disk::add_device(io::file file, bool preallocate_space, bool direct_io)
 {
-    auto stat = m_file.stat();
+    auto device = std::make_unique<struct device>();
+
+    device->file = std::move(file);
+    device->preallocate_space = preallocate_space;
+
+    device->file.set_direct_io(direct_io);
+
+    if (io::register_file(device->file.fd()) == -1)
+    {
+        logger::warning("{}: unable to register file: {}", device->file.path(), system_error().message);
+    }
+
+    auto stat = device->file.stat();
 
     if (S_ISBLK(stat.st_mode) == false)
     {
         if ((stat.st_size & page_mask) != 0)
         {
-            throw error("{}: invalid data image", m_file.path());
+            throw error("{}: invalid data image", device->file.path());
         }
 
-        m_blocks.extend(stat.st_size >> 12);
+        device->blocks.extend(stat.st_size >> 12);
     }
     else
     {
-        m_preallocate_space = false;
+        device->block_device = true;
+        device->preallocate_space = false;
+
+        device->discard_enabled = discard_rate != 0;
 
         uint64_t size;
 
-        if (ioctl(m_file.fd(), BLKGETSIZE64, &size) == -1)
+        if (ioctl(device->file.fd(), BLKGETSIZE64, &size) == -1)
         {
-            throw error("{}: {}", m_file.path(), system_error().message);
+            throw error("{}: {}", device->file.path(), system_error().message);
         }
 
         if ((size & page_mask) != 0)
         {
-            throw error("{}: invalid data image", m_file.path());
+            throw error("{}: invalid data image", device->file.path());
         }
 
-        m_blocks.extend(size >> 12);
+        device->blocks.extend(size >> 12);
     }
+
+    m_devices.push_back(std::move(device));
 }
 
-void disk::allocate_space()
+void disk::allocate_space(device* device)
 {
-    if (unlikely(m_allocation_in_progress == true))
+    if (unlikely(device->allocation_in_progress == true))
     {
-        m_allocation_cond.wait();
+        device->allocation_cond.wait();
     }
     else
     {
-        m_allocation_in_progress = true;
+        device->allocation_in_progress = true;
 
-        if (m_preallocate_space == true)
+        if (device->preallocate_space == true)
         {
-            uint64_t offset = static_cast<uint64_t>(m_blocks.capacity()) << page_bits;
+            uint64_t offset = static_cast<uint64_t>(device->blocks.capacity()) << page_bits;
             uint64_t size = 32768UL << page_bits;
 
-            m_file.allocate(0, offset, size);
+            device->file.allocate(0, offset, size);
         }
 
-        m_blocks.extend(32768);
+        device->blocks.extend(32768);
 
-        m_allocation_in_progress = false;
-        m_allocation_cond.signal_all();
+        device->allocation_in_progress = false;
+        device->allocation_cond.signal_all();
     }
 }
 
+void disk::sync_device(device* device, uint32_t* pending, bool* failed, gt::condition* cond)
+{
+    try
+    {
+        device->file.sync();
+    }
+    catch (exception& e)
+    {
+        logger::error("{}", e.what());
+        *failed = true;
+    }
+
+    if (--*pending == 0)
+    {
+        cond->signal();
+    }
+}
+
+void disk::queue_discard(device* device, uint32_t page, uint32_t pages)
+{
+    auto& discards = device->discards;
+    auto next = discards.lower_bound(page);
+
+    if (next != discards.begin())
+    {
+        auto prev = std::prev(next);
+
+        if (prev->first + prev->second.pages == page)
+        {
+            page = prev->first;
+            pages += prev->second.pages;
+
+            discards.erase(prev);
+        }
+    }
+
+    if (next != discards.end() && page + pages == next->first)
+    {
+        pages += next->second.pages;
+
+        discards.erase(next);
+    }
+
+    discards[page] = discard{pages, m_sync_epoch};
+}
+
+void disk::release_discards(device* device)
+{
+    for (auto&& it : device->discards)
+    {
+        device->blocks.free(it.first, it.second.pages);
+    }
+
+    device->discards.clear();
+}
+
+void disk::discard_thread(device* device)
+{
+    uint64_t delay = 0;
+
+    while (device->discard_enabled == true && gt::terminated() == false)
+    {
+        auto it = device->discards.begin();
+
+        while (it != device->discards.end() && it->second.epoch + 2 > m_sync_epoch)
+        {
+            ++it;
+        }
+
+        if (it == device->discards.end())
+        {
+            break;
+        }
+
+        uint32_t page = it->first;
+        uint32_t pages = std::min(it->second.pages, max_discard_pages);
+
+        if (pages < it->second.pages)
+        {
+            device->discards[page + pages] = discard{it->second.pages - pages, it->second.epoch};
+        }
+
+        device->discards.erase(it);
+
+        try
+        {
+            device->file.allocate(FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                                  static_cast<uint64_t>(page) << page_bits,
+                                  static_cast<uint64_t>(pages) << page_bits);
+        }
+        catch (exception& e)
+        {
+            logger::warning("{}, discards disabled", e.what());
+            device->discard_enabled = false;
+        }
+
+        device->blocks.free(page, pages);
+
+        if (discard_rate != 0)
+        {
+            delay += (static_cast<uint64_t>(pages) << page_bits) * 1000;
+
+            if (delay >= discard_rate)
+            {
+                gt::sleep(delay / discard_rate);
+                delay %= discard_rate;
+            }
+        }
+    }
+
+    if (device->discard_enabled == false)
+    {
+        release_discards(device);
+    }
+
+    device->discard_active = false;
+}
+
 }
@@ -6,6 +6,10 @@
 #include <io/file.h>
 #include <storage/common.h>
 
+#include <map>
+#include <memory>
+#include <vector>
+
 
 namespace tyrtech::storage {
 
@@ -29,38 +33,98 @@ public:
     }
 
 public:
-    void read(uint32_t page, char* buff);
-    uint32_t write(uint32_t page, iovec* iovec, uint32_t size);
+    void read(uint32_t device, uint32_t page, char* buff);
+    uint32_t read(uint32_t device, uint32_t page, iovec* iovec, uint32_t size);
+    uint32_t write(uint32_t device, uint32_t page, iovec* iovec, uint32_t size);
+
+    uint64_t allocate(uint32_t pages);
+    void allocate(uint32_t pages, extents_t* extents);
 
-    uint32_t allocate(uint32_t pages);
-    void free(uint32_t page, uint32_t pages);
+    uint32_t stripes(uint32_t pages) const;
+    void free(uint32_t device, uint32_t page, uint32_t pages);
 
     void remove(const extents_t& extents);
 
+    bool reserve(uint32_t device, uint32_t page, uint32_t pages);
+    void reserve_cache_id(uint64_t cache_id);
+
+    void sync();
+
     uint32_t size() const;
     uint32_t capacity() const;
+    uint32_t capacity(uint32_t device) const;
+
+    uint32_t devices() const;
+
+    void histogram(std::vector<uint64_t>* free_ranges) const;
 
     std::string_view path() const;
+    std::string_view path(uint32_t device) const;
 
     uint64_t new_cache_id();
 
 public:
-    disk(io::file file, bool preallocate_space);
+    static constexpr uint64_t default_discard_rate{64UL << 20};
+
+public:
+    static void set_discard_rate(uint64_t bytes);
+
+public:
+    disk(io::file file, bool preallocate_space, bool direct_io);
+    disk(std::vector<io::file> files, bool preallocate_space, bool direct_io);
 
 private:
-    io::file m_file;
+    static constexpr uint32_t max_discard_pages{8192};
 
-    gt::condition m_allocation_cond;
-    bool m_allocation_in_progress{false};
+private:
+    struct discard
+    {
+        uint32_t pages{0};
+        uint64_t epoch{0};
+    };
 
-    bool m_preallocate_space{false};
+    using discards_t =
+            std::map<uint32_t, discard>;
 
-    allocator m_blocks;
+    struct device
+    {
+        io::file file;
+
+        gt::condition allocation_cond;
+        bool allocation_in_progress{false};
+
+        bool preallocate_space{false};
+        bool block_device{false};
+
+        allocator blocks;
+
+        discards_t discards;
+
+        bool discard_enabled{false};
+        bool discard_active{false};
+    };
+
+    using devices_t =
+            std::vector<std::unique_ptr<device>>;
+
+private:
+    devices_t m_devices;
+    uint32_t m_next_device{0};
 
     uint64_t m_next_cache_id{1};
 
+    uint64_t m_sync_epoch{0};
+
 private:
-    void allocate_space();
+    void add_device(io::file file, bool preallocate_space, bool direct_io);
+    void allocate_space(device* device);
+
+    void sync_device(device* device, uint32_t* pending, bool* failed, gt::condition* cond);
+
+    void queue_discard(device* device, uint32_t page, uint32_t pages);
+    void release_discards(device* device);
+
+    void discard_thread(device* device);
 };
 
 }
@@ -4,7 +4,10 @@
 namespace tyrtech::storage {
 
 
-const char* disk_reader::read(uint64_t cache_id, uint32_t file_page, const extents_t& extents)
+const char* disk_reader::read(uint64_t cache_id,
+                              uint32_t file_page,
+                              uint32_t pages,
+                              const extents_t& extents)
 {
     assert(likely(file_page < (1U << file_pages_bits)));
     uint64_t cache_key = (cache_id << file_pages_bits) | file_page;
@@ -23,27 +26,95 @@ const char* disk_reader::read(uint64_t cache_id, uint32_t file_page, const exten
         mem_page = m_cache->allocate();
         m_latch.set(cache_key, mem_page);
 
-        uint32_t disk_page = get_disk_page(file_page, extents);
-        m_disk->read(disk_page, m_cache->get_memory(mem_page));
+        uint32_t epoch = m_read_epoch;
+        m_reads[epoch]++;
 
-        m_latch.release(cache_key);
+        uint32_t device = 0;
+        uint32_t extent_pages = 0;
+        uint32_t disk_page = get_disk_page(file_page, extents, &device, &extent_pages);
+
+        load(cache_key, mem_page, device, disk_page, std::min(pages, extent_pages));
+
+        end_read(epoch);
     }
     else
     {
         m_latch.wait_for(cache_key);
     }
 
-    if (m_latch.remove(cache_key) == true)
+    return finish_read(cache_key, mem_page);
+}
+
+void disk_reader::remove(const extents_t& extents)
+{
+    m_disk->remove(extents);
+}
+
+void disk_reader::add_file(file_descriptor* descriptor)
+{
+    m_files.emplace(descriptor->cache_id, descriptor);
+}
+
+void disk_reader::remove_file(file_descriptor* descriptor)
+{
+    auto range = m_files.equal_range(descriptor->cache_id);
+
+    for (auto it = range.first; it != range.second; ++it)
     {
-        m_cache->add(cache_key, mem_page);
+        if (it->second == descriptor)
+        {
+            m_files.erase(it);
+            break;
+        }
     }
+}
 
-    return m_cache->get_memory(mem_page);
+bool disk_reader::relocate(uint64_t cache_id, const extents_t& extents, const extents_t& new_extents)
+{
+    if (contains(cache_id, extents) == false)
+    {
+        return false;
+    }
+
+    auto range = m_files.equal_range(cache_id);
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        it->second->extents = new_extents;
+    }
+
+    return true;
 }
 
-void disk_reader::remove(const extents_t& extents)
+bool disk_reader::contains(uint64_t cache_id, const extents_t& extents) const
 {
-    m_disk->remove(extents);
+    auto range = m_files.equal_range(cache_id);
+
+    if (range.first == range.second)
+    {
+        return false;
+    }
+
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second->extents != extents)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void disk_reader::wait_for_reads()
+{
+    uint32_t epoch = m_read_epoch;
+    m_read_epoch ^= 1;
+
+    while (m_reads[epoch] != 0)
+    {
+        m_reads_cond.wait();
+    }
 }
 
 disk_reader::disk_reader(disk* disk, cache* cache)
@@ -53,23 +124,143 @@ disk_reader::disk_reader(disk* disk, cache* cache)
     m_latch.set_empty_value(invalid_handle);
 }
 
-uint32_t disk_reader::get_disk_page(uint32_t file_page, const extents_t& extents)
+void disk_reader::load(uint64_t cache_key,
+                       uint32_t mem_page,
+                       uint32_t device,
+                       uint32_t disk_page,
+                       uint32_t pages)
+{
+    pages = std::min(pages, max_read_pages);
+
+    uint32_t mem_pages[max_read_pages];
+    iovec iov[max_read_pages];
+
+    mem_pages[0] = mem_page;
+
+    iov[0].iov_base = m_cache->get_memory(mem_page);
+    iov[0].iov_len = page_size;
+
+    uint32_t count = 1;
+
+    while (count < pages)
+    {
+        uint64_t next_cache_key = cache_key + count;
+
+        if (m_cache->contains(next_cache_key) == true || m_latch.contains(next_cache_key) == true)
+        {
+            break;
+        }
+
+        m_latch.acquire(next_cache_key);
+
+        mem_pages[count] = m_cache->allocate();
+        m_latch.set(next_cache_key, mem_pages[count]);
+
+        iov[count].iov_base = m_cache->get_memory(mem_pages[count]);
+        iov[count].iov_len = page_size;
+
+        count++;
+    }
+
+    std::exception_ptr error;
+
+    try
+    {
+        if (count == 1)
+        {
+            m_disk->read(device, disk_page, m_cache->get_memory(mem_page));
+        }
+        else if (m_disk->read(device, disk_page, iov, count) != (count << page_bits))
+        {
+            throw disk::error("{}: unable to read", m_disk->path(device));
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        m_latch.release(cache_key + i, error);
+    }
+
+    for (uint32_t i = 1; i < count; i++)
+    {
+        if (m_latch.remove(cache_key + i) == false)
+        {
+            continue;
+        }
+
+        if (error == nullptr)
+        {
+            m_cache->add(cache_key + i, mem_pages[i]);
+        }
+        else
+        {
+            m_cache->free(mem_pages[i]);
+        }
+    }
+}
+
+void disk_reader::end_read(uint32_t epoch)
+{
+    assert(likely(m_reads[epoch] != 0));
+
+    if (--m_reads[epoch] == 0 && epoch != m_read_epoch)
+    {
+        m_reads_cond.signal_all();
+    }
+}
+
+const char* disk_reader::finish_read(uint64_t cache_key, uint32_t mem_page)
+{
+    std::exception_ptr error = m_latch.error(cache_key);
+
+    if (m_latch.remove(cache_key) == true)
+    {
+        if (error == nullptr)
+        {
+            m_cache->add(cache_key, mem_page);
+        }
+        else
+        {
+            m_cache->free(mem_page);
+        }
+    }
+
+    if (error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+
+    return m_cache->get_memory(mem_page);
+}
+
+uint32_t disk_reader::get_disk_page(uint32_t file_page,
+                                    const extents_t& extents,
+                                    uint32_t* device,
+                                    uint32_t* pages)
 {
     uint32_t disk_page = invalid_handle;
 
+    *pages = 0;
+
     for (auto&& extent : extents)
     {
-        uint32_t extent_page = extent >> 32;
-        uint32_t extent_pages = extent & 0xffffffffU;
+        uint32_t pages_in_extent = extent_pages(extent);
 
-        if (extent_pages > file_page)
+        if (pages_in_extent > file_page)
         {
-            disk_page = extent_page + file_page;
+            disk_page = extent_page(extent) + file_page;
+
+            *device = extent_device(extent);
+            *pages = pages_in_extent - file_page;
 
             break;
         }
 
-        file_page -= extent_pages;
+        file_page -= pages_in_extent;
     }
 
     return disk_page;
@@ -5,6 +5,9 @@
 #include <storage/cache.h>
 #include <storage/latch.h>
 
+#include <array>
+#include <unordered_map>
+
 
 namespace tyrtech::storage {
 
@@ -12,25 +15,65 @@ namespace tyrtech::storage {
 class disk_reader : private disallow_copy
 {
 public:
-    const char* read(uint64_t cache_id, uint32_t file_page, const extents_t& extents);
+    const char* read(uint64_t cache_id,
+                     uint32_t file_page,
+                     uint32_t pages,
+                     const extents_t& extents);
 
     void remove(const extents_t& extents);
 
+    void add_file(file_descriptor* descriptor);
+    void remove_file(file_descriptor* descriptor);
+
+    bool relocate(uint64_t cache_id, const extents_t& extents, const extents_t& new_extents);
+    bool contains(uint64_t cache_id, const extents_t& extents) const;
+
+    void wait_for_reads();
+
 public:
     disk_reader(disk* disk, cache* cache);
 
+private:
+    static constexpr uint32_t max_read_pages{32};
+
 private:
     using latch_t =
             latch<uint64_t, uint32_t>;
 
+    using files_t =
+            std::unordered_multimap<uint64_t, file_descriptor*>;
+
+    using reads_t =
+            std::array<uint64_t, 2>;
+
 private:
     disk* m_disk{nullptr};
     cache* m_cache{nullptr};
 
     latch_t m_latch;
 
+    files_t m_files;
+
+    reads_t m_reads{{0}};
+    uint32_t m_read_epoch{0};
+
+    gt::condition m_reads_cond;
+
 private:
-    uint32_t get_disk_page(uint32_t file_page, const extents_t& extents);
+    void load(uint64_t cache_key,
+              uint32_t mem_page,
+              uint32_t device,
+              uint32_t disk_page,
+              uint32_t pages);
+
+    void end_read(uint32_t epoch);
+
+    const char* finish_read(uint64_t cache_key, uint32_t mem_page);
+
+    uint32_t get_disk_page(uint32_t file_page,
+                           const extents_t& extents,
+                           uint32_t* device,
+                           uint32_t* pages);
 };
 
 }
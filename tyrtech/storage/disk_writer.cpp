@@ -1,10 +1,11 @@
+#include <common/logger.h>
 #include <storage/disk_writer.h>
 
-#include <limits.h>
 
+namespace tyrtech::storage {
 
 
-namespace tyrtech::storage {
+thread_local uint32_t queue_depth{disk_writer::default_queue_depth};
 
 
 disk_writer::state* disk_writer::allocate()
@@ -20,12 +21,14 @@ disk_writer::state* disk_writer::allocate()
     state->descriptor.extents.clear();
     state->mem_page = invalid_handle;
     state->state_handle = m_states.back();
+    state->write_failed = false;
 
     return state;
 }
 
 void disk_writer::free(state* state)
 {
+    assert(likely(m_latch.find(state->descriptor.cache_id) == m_latch.end()));
     m_states.erase(state->state_handle);
 }
 
@@ -65,10 +68,17 @@ void disk_writer::write_page(state* state)
 void disk_writer::flush_pages(state* state)
 {
     flush_pages(state, true);
+
+    if (state->write_failed == true)
+    {
+        throw disk::error("{}: unable to write", m_disk->path());
+    }
 }
 
 void disk_writer::remove(state* state)
 {
+    wait_for_flush(state);
+
     if (state->mem_page != invalid_handle)
     {
         m_cache->free(state->mem_page);
@@ -88,10 +98,18 @@ void disk_writer::remove(state* state)
     m_dirty_pages_cond.signal_all();
 }
 
+void disk_writer::set_queue_depth(uint32_t depth)
+{
+    assert(likely(depth != 0));
+    queue_depth = depth;
+}
+
 disk_writer::disk_writer(disk* disk, cache* cache, uint32_t write_cache_bits)
   : m_disk(disk)
   , m_cache(cache)
   , m_max_dirty_pages(1U << write_cache_bits)
+  , m_writes(disk->devices())
+  , m_writes_cond(disk->devices())
 {
 }
 
@@ -102,20 +120,14 @@ uint64_t disk_writer::new_cache_id()
 
 void disk_writer::flush_pages(state* state, bool wait)
 {
+    if (m_latch.find(state->descriptor.cache_id) != m_latch.end())
     {
-        auto it = m_latch.find(state->descriptor.cache_id);
-
-        if (it != m_latch.end())
+        if (wait == false)
         {
-            if (wait == true)
-            {
-                it->second.wait();
-            }
-            else
-            {
-                return;
-            }
+            return;
         }
+
+        wait_for_flush(state);
     }
 
     if (state->cached_pages.size() == 0)
@@ -123,7 +135,7 @@ void disk_writer::flush_pages(state* state, bool wait)
         return;
     }
 
-    auto& cond = m_latch[state->descriptor.cache_id];
+    auto& flush = m_latch[state->descriptor.cache_id];
 
     state::cached_pages_t cached_pages;
     std::swap(state->cached_pages, cached_pages);
@@ -132,59 +144,200 @@ void disk_writer::flush_pages(state* state, bool wait)
 
     for (auto&& extent : state->descriptor.extents)
     {
-        file_page += extent & 0xffffffffU;
+        file_page += extent_pages(extent);
     }
 
     uint32_t pages = cached_pages.size();
-    uint32_t disk_page = m_disk->allocate(pages);
 
-    state->descriptor.extents.push_back((static_cast<uint64_t>(disk_page) << 32) | pages);
+    extents_t extents;
+
+    try
+    {
+        m_disk->allocate(pages, &extents);
+    }
+    catch (...)
+    {
+        cached_pages.insert(cached_pages.end(),
+                            state->cached_pages.begin(),
+                            state->cached_pages.end());
+        std::swap(state->cached_pages, cached_pages);
+
+        flush.cond.signal_all();
+        m_latch.erase(state->descriptor.cache_id);
+
+        throw;
+    }
+
+    uint32_t writes = 0;
+
+    for (auto&& extent : extents)
+    {
+        writes += (extent_pages(extent) + max_write_pages - 1) / max_write_pages;
+    }
+
+    for (auto&& extent : extents)
+    {
+        add_extent(&state->descriptor.extents, extent);
+    }
+
+    flush.pending = writes;
 
     auto it = cached_pages.begin();
 
-    while (pages != 0)
+    for (auto&& extent : extents)
     {
-        uint32_t size = std::min(static_cast<uint32_t>(IOV_MAX), pages);
-        iovec iov[IOV_MAX];
+        uint32_t device = extent_device(extent);
+        uint32_t disk_page = extent_page(extent);
 
-        for (uint32_t i = 0; i < size; i++)
+        pages = extent_pages(extent);
+
+        while (pages != 0)
         {
-            assert(likely(it != cached_pages.end()));
+            uint32_t size = std::min(max_write_pages, pages);
 
-            iov[i].iov_base = m_cache->get_memory(*it);
-            iov[i].iov_len = page_size;
+            while (m_writes[device] >= queue_depth)
+            {
+                m_writes_cond[device].wait();
+            }
+
+            m_writes[device]++;
+
+            gt::create_thread(&disk_writer::write_pages,
+                              this,
+                              state,
+                              &flush,
+                              device,
+                              disk_page,
+                              file_page,
+                              std::vector<uint32_t>(it, it + size));
+
+            it += size;
+
+            disk_page += size;
+            file_page += size;
+            pages -= size;
+        }
+    }
+
+    if (wait == true)
+    {
+        wait_for_flush(state);
+    }
+}
+
+void disk_writer::wait_for_flush(state* state)
+{
+    while (true)
+    {
+        auto it = m_latch.find(state->descriptor.cache_id);
 
-            ++it;
+        if (it == m_latch.end())
+        {
+            break;
         }
 
-        auto res = m_disk->write(disk_page, iov, size);
+        it->second.cond.wait();
+    }
+}
+
+void disk_writer::write_pages(state* state,
+                              flush* flush,
+                              uint32_t device,
+                              uint32_t disk_page,
+                              uint32_t file_page,
+                              const std::vector<uint32_t>& mem_pages)
+{
+    uint32_t size = mem_pages.size();
+    bool written = false;
+
+    if (flush->failed == false)
+    {
+        iovec iov[max_write_pages];
 
-        if (res != (size << page_bits))
+        for (uint32_t i = 0; i < size; i++)
         {
-            throw disk::error("{}: unable to write", m_disk->path());
+            iov[i].iov_base = m_cache->get_memory(mem_pages[i]);
+            iov[i].iov_len = page_size;
         }
 
-        disk_page += size;
-        pages -= size;
+        try
+        {
+            written = m_disk->write(device, disk_page, iov, size) == (size << page_bits);
+        }
+        catch (exception& e)
+        {
+            logger::error("{}", e.what());
+        }
     }
 
-    for (auto&& mem_page : cached_pages)
+    if (written == true)
     {
-        assert(likely(file_page < (1U << file_pages_bits)));
-        uint64_t cache_key = (state->descriptor.cache_id << file_pages_bits) | file_page++;
+        for (auto&& mem_page : mem_pages)
+        {
+            assert(likely(file_page < (1U << file_pages_bits)));
+            uint64_t cache_key = (state->descriptor.cache_id << file_pages_bits) | file_page++;
 
-        m_cache->add(cache_key, mem_page);
+            m_cache->add(cache_key, mem_page);
+        }
     }
+    else
+    {
+        for (auto&& mem_page : mem_pages)
+        {
+            m_cache->free(mem_page);
+        }
 
-    assert(likely(m_dirty_pages >= cached_pages.size()));
+        flush->failed = true;
+    }
+
+    assert(likely(m_dirty_pages >= size));
 
-    m_dirty_pages -= cached_pages.size();
+    m_dirty_pages -= size;
     m_dirty_pages_cond.signal_all();
 
-    cond.signal_all();
+    assert(likely(m_writes[device] != 0));
+
+    m_writes[device]--;
+    m_writes_cond[device].signal();
+
+    assert(likely(flush->pending != 0));
+
+    if (--flush->pending != 0)
+    {
+        return;
+    }
+
+    if (flush->failed == true)
+    {
+        state->write_failed = true;
+    }
+
+    flush->cond.signal_all();
     m_latch.erase(state->descriptor.cache_id);
 }
 
+void disk_writer::add_extent(extents_t* extents, uint64_t extent)
+{
+    if (extents->empty() == false)
+    {
+        uint64_t last = extents->back();
+
+        uint32_t device = extent_device(last);
+        uint32_t page = extent_page(last);
+        uint32_t pages = extent_pages(last) + extent_pages(extent);
+
+        if (device == extent_device(extent) &&
+            page + extent_pages(last) == extent_page(extent) &&
+            pages <= file_pages_mask)
+        {
+            extents->back() = make_extent(device, page, pages);
+            return;
+        }
+    }
+
+    extents->push_back(extent);
+}
+
 void disk_writer::start_global_flush()
 {
     if (m_global_flush_active == true)
@@ -6,6 +6,8 @@
 #include <storage/disk.h>
 #include <storage/cache.h>
 
+#include <limits.h>
+
 
 namespace tyrtech::storage {
 
@@ -33,6 +35,8 @@ public:
         uint32_t mem_page{invalid_handle};
         uint32_t state_handle{invalid_handle};
 
+        bool write_failed{false};
+
     private:
         friend class disk_writer;
     }; // TODO: __attribute__ ((packed))
@@ -48,12 +52,32 @@ public:
 
     void remove(state* state);
 
+public:
+    static constexpr uint32_t default_queue_depth{8};
+
+public:
+    static void set_queue_depth(uint32_t depth);
+
 public:
     disk_writer(disk* disk, cache* cache, uint32_t write_cache_bits);
 
+private:
+    static constexpr uint32_t max_write_pages{256};
+
+    static_assert(max_write_pages <= IOV_MAX, "max_write_pages too large");
+
+private:
+    struct flush
+    {
+        gt::condition cond;
+
+        uint32_t pending{0};
+        bool failed{false};
+    };
+
 private:
     using latch_t =
-            std::unordered_map<uint64_t, gt::condition>;
+            std::unordered_map<uint64_t, flush>;
 
     using states_t =
             slab_list<state, 1024>;
@@ -67,6 +91,9 @@ private:
 
     gt::condition m_dirty_pages_cond;
 
+    std::vector<uint32_t> m_writes;
+    std::vector<gt::condition> m_writes_cond;
+
     bool m_global_flush_active{false};
 
     states_t::entry_pool_t m_state_entries;
@@ -78,6 +105,16 @@ private:
     uint64_t new_cache_id();
 
     void flush_pages(state* state, bool wait);
+    void wait_for_flush(state* state);
+
+    void write_pages(state* state,
+                     flush* flush,
+                     uint32_t device,
+                     uint32_t disk_page,
+                     uint32_t file_page,
+                     const std::vector<uint32_t>& mem_pages);
+
+    static void add_extent(extents_t* extents, uint64_t extent);
 
     void start_global_flush();
     void flush_thread();
@@ -2,6 +2,8 @@
 #include <common/disallow_move.h>
 #include <storage/engine.h>
 
+#include <atomic>
+
 
 namespace tyrtech::storage {
 
@@ -9,49 +11,86 @@ namespace tyrtech::storage {
 struct engine : private disallow_copy, disallow_move
 {
     disk disk;
+    manifest manifest;
     cache cache;
 
     disk_reader disk_reader;
     disk_writer disk_writer;
 
+    defragmenter defragmenter;
+
+    uint64_t id{0};
+
     file_reader create_reader(file_descriptor&& descriptor);
     file_writer create_writer();
     uint32_t capacity() const;
     uint32_t size() const;
     std::string_view path() const;
 
-    engine(io::file file,
+    engine(std::vector<io::file> files,
            uint32_t cache_bits,
            uint32_t write_cache_bits,
-           bool preallocate_space);
+           bool preallocate_space,
+           bool direct_io,
+           bool recover);
 };
 
-engine::engine(io::file file,
+engine::engine(std::vector<io::file> files,
                uint32_t cache_bits,
                uint32_t write_cache_bits,
-               bool preallocate_space)
-  : disk(std::move(file), preallocate_space)
+               bool preallocate_space,
+               bool direct_io,
+               bool recover)
+  : disk(std::move(files), preallocate_space, direct_io)
+  , manifest(&disk, recover)
   , cache(cache_bits)
   , disk_reader(&disk, &cache)
   , disk_writer(&disk, &cache, write_cache_bits)
+  , defragmenter(&disk, &disk_reader, &manifest)
 {
     assert(likely(cache_bits > 6));
     assert(likely(cache_bits > write_cache_bits));
 }
 
 
+std::atomic<uint64_t> __next_id{1};
+
 thread_local std::unique_ptr<engine> __engine;
 
 
 void initialize(io::file file,
                 uint32_t cache_bits,
                 uint32_t write_cache_bits,
-                bool preallocate_space)
+                bool preallocate_space,
+                bool direct_io,
+                bool recover)
+{
+    std::vector<io::file> files;
+    files.push_back(std::move(file));
+
+    initialize(std::move(files),
+               cache_bits,
+               write_cache_bits,
+               preallocate_space,
+               direct_io,
+               recover);
+}
+
+void initialize(std::vector<io::file> files,
+                uint32_t cache_bits,
+                uint32_t write_cache_bits,
+                bool preallocate_space,
+                bool direct_io,
+                bool recover)
 {
-    __engine = std::make_unique<engine>(std::move(file),
+    __engine = std::make_unique<engine>(std::move(files),
                                         cache_bits,
                                         write_cache_bits,
-                                        preallocate_space);
+                                        preallocate_space,
+                                        direct_io,
+                                        recover);
+
+    __engine->id = __next_id.fetch_add(1, std::memory_order_relaxed);
 }
 
 uint64_t new_cache_id()
@@ -69,6 +108,46 @@ file_writer create_writer()
     return file_writer(&__engine->disk_writer);
 }
 
+const manifest::files_t& recover()
+{
+    return __engine->manifest.recover();
+}
+
+void add_file(uint64_t owner, const file_descriptor& descriptor)
+{
+    __engine->manifest.add(owner, descriptor);
+}
+
+void remove_file(uint64_t cache_id)
+{
+    __engine->manifest.remove(cache_id);
+}
+
+void commit()
+{
+    __engine->manifest.commit();
+}
+
+uint32_t defragment()
+{
+    return __engine->defragmenter.defragment();
+}
+
+void start_defragmenter(uint64_t interval)
+{
+    __engine->defragmenter.start(interval);
+}
+
+fragmentation_stats fragmentation()
+{
+    return __engine->defragmenter.stats();
+}
+
+uint32_t devices()
+{
+    return __engine->disk.devices();
+}
+
 uint32_t capacity()
 {
     return __engine->disk.capacity();
@@ -84,4 +163,9 @@ std::string_view path()
     return __engine->disk.path();
 }
 
+uint64_t id()
+{
+    return __engine->id;
+}
+
 }
@@ -1,8 +1,10 @@
 #pragma once
 
 
+#include <storage/defragmenter.h>
 #include <storage/file_reader.h>
 #include <storage/file_writer.h>
+#include <storage/manifest.h>
 
 
 namespace tyrtech::storage {
@@ -11,15 +13,38 @@ namespace tyrtech::storage {
 void initialize(io::file file,
                 uint32_t cache_bits,
                 uint32_t write_cache_bits,
-                bool preallocate_space);
+                bool preallocate_space,
+                bool direct_io,
+                bool recover);
 
+void initialize(std::vector<io::file> files,
+                uint32_t cache_bits,
+                uint32_t write_cache_bits,
+                bool preallocate_space,
+                bool direct_io,
+                bool recover);
+
+uint32_t devices();
 uint32_t capacity();
 uint32_t size();
 std::string_view path();
+uint64_t id();
 
 uint64_t new_cache_id();
 
 file_reader create_reader(file_descriptor&& descriptor);
 file_writer create_writer();
 
+const manifest::files_t& recover();
+
+void add_file(uint64_t owner, const file_descriptor& descriptor);
+void remove_file(uint64_t cache_id);
+
+void commit();
+
+uint32_t defragment();
+void start_defragmenter(uint64_t interval);
+
+fragmentation_stats fragmentation();
+
 }
@@ -6,20 +6,23 @@ namespace tyrtech::storage {
 
 uint32_t file_reader::pread(uint64_t offset, char* data, uint32_t size) const
 {
-    assert(likely(offset < m_descriptor.size));
+    assert(likely(offset < m_descriptor->size));
 
-    if (offset + size > m_descriptor.size)
+    if (offset + size > m_descriptor->size)
     {
-        size = m_descriptor.size - offset;
+        size = m_descriptor->size - offset;
     }
 
     uint32_t requested_size = size;
 
     while (size != 0)
     {
-        auto page_data = m_reader->read(m_descriptor.cache_id,
+        uint32_t pages = ((offset + size - 1) >> page_bits) - (offset >> page_bits) + 1;
+
+        auto page_data = m_reader->read(m_descriptor->cache_id,
                                         offset >> page_bits,
-                                        m_descriptor.extents);
+                                        pages,
+                                        m_descriptor->extents);
 
         if (page_data == nullptr)
         {
@@ -44,28 +47,38 @@ uint32_t file_reader::pread(uint64_t offset, char* data, uint32_t size) const
 
 void file_reader::unlink()
 {
-    m_reader->remove(m_descriptor.extents);
+    m_reader->remove_file(m_descriptor.get());
+    m_reader->remove(m_descriptor->extents);
 }
 
 const file_descriptor& file_reader::descriptor() const
 {
-    return m_descriptor;
+    return *m_descriptor;
 }
 
 uint32_t file_reader::size() const
 {
-    return m_descriptor.size;
+    return m_descriptor->size;
 }
 
 const extents_t& file_reader::extents() const
 {
-    return m_descriptor.extents;
+    return m_descriptor->extents;
 }
 
 file_reader::file_reader(disk_reader* reader, file_descriptor&& descriptor)
   : m_reader(reader)
-  , m_descriptor(std::move(descriptor))
+  , m_descriptor(std::make_unique<file_descriptor>(std::move(descriptor)))
 {
+    m_reader->add_file(m_descriptor.get());
+}
+
+file_reader::~file_reader()
+{
+    if (m_reader != nullptr)
+    {
+        m_reader->remove_file(m_descriptor.get());
+    }
 }
 
 file_reader::file_reader(file_reader&& other)
@@ -75,6 +88,11 @@ file_reader::file_reader(file_reader&& other)
 
 file_reader& file_reader::operator=(file_reader&& other)
 {
+    if (m_reader != nullptr)
+    {
+        m_reader->remove_file(m_descriptor.get());
+    }
+
     m_reader = other.m_reader;
     m_descriptor = std::move(other.m_descriptor);
 
@@ -3,6 +3,8 @@
 
 #include <storage/disk_reader.h>
 
+#include <memory>
+
 
 namespace tyrtech::storage {
 
@@ -23,13 +25,19 @@ public:
     file_reader() = default;
     file_reader(disk_reader* reader, file_descriptor&& descriptor);
 
+    ~file_reader();
+
 public:
     file_reader(file_reader&& other);
     file_reader& operator=(file_reader&& other);
 
+private:
+    using descriptor_ptr =
+            std::unique_ptr<file_descriptor>;
+
 private:
     disk_reader* m_reader{nullptr};
-    file_descriptor m_descriptor;
+    descriptor_ptr m_descriptor;
 };
 
 }
@@ -4,6 +4,7 @@
 #include <gt/condition.h>
 
 #include <unordered_map>
+#include <exception>
 
 
 namespace tyrtech::storage {
@@ -31,11 +32,17 @@ public:
     }
 
     void release(const Key& key)
+    {
+        release(key, std::exception_ptr());
+    }
+
+    void release(const Key& key, std::exception_ptr error)
     {
         auto it = m_entries.find(key);
         assert(likely(it != m_entries.end()));
 
         it->second.released = true;
+        it->second.error = std::move(error);
         it->second.cond.signal_all();
     }
 
@@ -67,6 +74,19 @@ public:
         return false;
     }
 
+    std::exception_ptr error(const Key& key) const
+    {
+        auto it = m_entries.find(key);
+        assert(likely(it != m_entries.end()));
+
+        return it->second.error;
+    }
+
+    bool contains(const Key& key) const
+    {
+        return m_entries.find(key) != m_entries.end();
+    }
+
     void set(const Key& key, const Value& value)
     {
         auto it = m_entries.find(key);
@@ -88,6 +108,8 @@ private:
         bool released{false};
         gt::condition cond;
 
+        std::exception_ptr error;
+
         Value value;
     };
 
@@ -0,0 +1,431 @@
+#include <common/aligned_buffer.h>
+#include <common/branch_prediction.h>
+#include <storage/manifest.h>
+
+#include <crc32c.h>
+#include <cstring>
+#include <algorithm>
+
+
+namespace tyrtech::storage {
+
+
+template<typename T>
+static void append(const T& data, std::string* records)
+{
+    records->append(reinterpret_cast<const char*>(&data), sizeof(T));
+}
+
+template<typename T>
+static bool consume(std::string_view* records, T* data)
+{
+    if (records->size() < sizeof(T))
+    {
+        return false;
+    }
+
+    std::memcpy(data, records->data(), sizeof(T));
+    records->remove_prefix(sizeof(T));
+
+    return true;
+}
+
+
+const manifest::files_t& manifest::recover()
+{
+    assert(likely(m_recovered == false));
+    m_recovered = true;
+
+    if (m_recover == false)
+    {
+        format();
+
+        return m_files;
+    }
+
+    std::string records;
+    uint64_t generation = 0;
+
+    for (uint32_t page = 0; page < (region_pages << 1); page += region_pages)
+    {
+        uint64_t region_generation = 0;
+
+        if (read_batch(page, &region_generation, &records) == 0)
+        {
+            continue;
+        }
+
+        if (region_of(region_generation) == page && region_generation > generation)
+        {
+            generation = region_generation;
+        }
+    }
+
+    if (generation == 0)
+    {
+        throw error("{}: invalid manifest", m_disk->path());
+    }
+
+    m_generation = generation;
+    m_page = region_of(generation);
+
+    while (true)
+    {
+        uint32_t pages = read_batch(m_page, &generation, &records);
+
+        if (pages == 0 || generation != m_generation)
+        {
+            break;
+        }
+
+        replay(records);
+
+        m_page += pages;
+    }
+
+    for (auto&& it : m_files)
+    {
+        auto& descriptor = it.second.descriptor;
+
+        for (auto&& extent : descriptor.extents)
+        {
+            if (m_disk->reserve(extent_device(extent),
+                                extent_page(extent),
+                                extent_pages(extent)) == false)
+            {
+                throw error("{}: invalid manifest extent", m_disk->path());
+            }
+        }
+
+        m_disk->reserve_cache_id(descriptor.cache_id);
+    }
+
+    checkpoint();
+
+    return m_files;
+}
+
+void manifest::add(uint64_t owner, const file_descriptor& descriptor)
+{
+    assert(likely(m_recovered == true));
+
+    auto& file = m_files[descriptor.cache_id];
+
+    file.owner = owner;
+    file.descriptor = descriptor;
+
+    add_record(file, &m_records);
+
+    m_sequence++;
+}
+
+void manifest::remove(uint64_t cache_id)
+{
+    assert(likely(m_recovered == true));
+
+    m_files.erase(cache_id);
+
+    append(record_type::remove, &m_records);
+    append(cache_id, &m_records);
+
+    m_sequence++;
+}
+
+void manifest::commit()
+{
+    uint64_t sequence = m_sequence;
+
+    while (m_commited_sequence < sequence)
+    {
+        if (m_commit_in_progress == true)
+        {
+            m_commit_cond.wait();
+            continue;
+        }
+
+        m_commit_in_progress = true;
+
+        uint64_t commited_sequence = m_sequence;
+        uint32_t pages = pages_for(m_records.size());
+
+        std::string records;
+
+        try
+        {
+            if (m_page + pages > region_of(m_generation) + region_pages)
+            {
+                checkpoint();
+            }
+            else
+            {
+                std::swap(records, m_records);
+
+                m_disk->sync();
+
+                write_batch(m_page, m_generation, records);
+                m_page += pages;
+
+                m_disk->sync();
+            }
+        }
+        catch (...)
+        {
+            restore_records(&records);
+
+            m_commit_in_progress = false;
+            m_commit_cond.signal_all();
+
+            throw;
+        }
+
+        m_commited_sequence = commited_sequence;
+
+        m_commit_in_progress = false;
+        m_commit_cond.signal_all();
+    }
+}
+
+const manifest::files_t& manifest::files() const
+{
+    return m_files;
+}
+
+manifest::manifest(disk* disk, bool recover)
+  : m_disk(disk)
+  , m_disk_pages(disk->capacity(0))
+  , m_recover(recover)
+{
+    if (m_disk->reserve(0, 0, region_pages << 1) == false)
+    {
+        throw error("{}: unable to reserve manifest", m_disk->path());
+    }
+}
+
+void manifest::format()
+{
+    std::string records;
+
+    for (uint32_t page = 0; page < (region_pages << 1); page += region_pages)
+    {
+        uint64_t region_generation = 0;
+
+        if (read_batch(page, &region_generation, &records) == 0)
+        {
+            continue;
+        }
+
+        m_generation = std::max(m_generation, region_generation);
+    }
+
+    checkpoint();
+    checkpoint();
+}
+
+void manifest::checkpoint()
+{
+    std::string records = snapshot();
+
+    if (pages_for(records.size()) > region_pages)
+    {
+        throw error("{}: manifest too large", m_disk->path());
+    }
+
+    uint64_t generation = m_generation + 1;
+    uint32_t page = region_of(generation);
+
+    std::string pending;
+    std::swap(pending, m_records);
+
+    try
+    {
+        m_disk->sync();
+
+        write_batch(page, generation, records);
+
+        m_disk->sync();
+    }
+    catch (...)
+    {
+        restore_records(&pending);
+        throw;
+    }
+
+    m_generation = generation;
+    m_page = page + pages_for(records.size());
+}
+
+void manifest::restore_records(std::string* records)
+{
+    records->append(m_records);
+    std::swap(*records, m_records);
+}
+
+std::string manifest::snapshot() const
+{
+    std::string records;
+
+    for (auto&& it : m_files)
+    {
+        add_record(it.second, &records);
+    }
+
+    return records;
+}
+
+void manifest::write_batch(uint32_t page, uint64_t generation, const std::string& records)
+{
+    uint32_t pages = pages_for(records.size());
+
+    aligned_buffer batch(page_size, pages << page_bits);
+    std::memset(batch.data(), 0, batch.size());
+
+    header h;
+
+    h.size = records.size();
+    h.generation = generation;
+
+    std::memcpy(batch.data() + sizeof(h), records.data(), records.size());
+    std::memcpy(batch.data(), &h, sizeof(h));
+
+    h.crc = crc32c_update(0,
+                          batch.data() + sizeof(h.crc),
+                          sizeof(h) - sizeof(h.crc) + records.size());
+
+    std::memcpy(batch.data(), &h, sizeof(h));
+
+    iovec iov;
+
+    iov.iov_base = batch.data();
+    iov.iov_len = batch.size();
+
+    if (m_disk->write(0, page, &iov, 1) != batch.size())
+    {
+        throw error("{}: unable to write manifest", m_disk->path());
+    }
+}
+
+uint32_t manifest::read_batch(uint32_t page, uint64_t* generation, std::string* records)
+{
+    uint32_t region_end = (page / region_pages + 1) * region_pages;
+
+    if (page >= std::min(region_end, m_disk_pages))
+    {
+        return 0;
+    }
+
+    aligned_buffer first_page(page_size, page_size);
+    m_disk->read(0, page, first_page.data());
+
+    header h;
+    std::memcpy(&h, first_page.data(), sizeof(h));
+
+    if (h.size > (region_end - page) * page_size - sizeof(h))
+    {
+        return 0;
+    }
+
+    uint32_t pages = pages_for(h.size);
+
+    if (page + pages > m_disk_pages)
+    {
+        return 0;
+    }
+
+    aligned_buffer batch(page_size, pages << page_bits);
+    std::memcpy(batch.data(), first_page.data(), page_size);
+
+    for (uint32_t i = 1; i < pages; i++)
+    {
+        m_disk->read(0, page + i, batch.data() + (i << page_bits));
+    }
+
+    uint32_t crc = crc32c_update(0,
+                                 batch.data() + sizeof(h.crc),
+                                 sizeof(h) - sizeof(h.crc) + h.size);
+
+    if (crc != h.crc)
+    {
+        return 0;
+    }
+
+    *generation = h.generation;
+    records->assign(batch.data() + sizeof(h), h.size);
+
+    return pages;
+}
+
+void manifest::replay(const std::string_view& records)
+{
+    std::string_view data = records;
+
+    while (data.size() != 0)
+    {
+        record_type type;
+        uint64_t cache_id;
+
+        if (consume(&data, &type) == false || consume(&data, &cache_id) == false)
+        {
+            throw error("{}: invalid manifest record", m_disk->path());
+        }
+
+        if (type == record_type::remove)
+        {
+            m_files.erase(cache_id);
+            continue;
+        }
+
+        if (type != record_type::add)
+        {
+            throw error("{}: invalid manifest record", m_disk->path());
+        }
+
+        file f;
+
+        uint32_t extent_count = 0;
+
+        f.descriptor.cache_id = cache_id;
+
+        if (consume(&data, &f.owner) == false ||
+            consume(&data, &f.descriptor.size) == false ||
+            consume(&data, &extent_count) == false ||
+            data.size() < extent_count * sizeof(uint64_t))
+        {
+            throw error("{}: invalid manifest record", m_disk->path());
+        }
+
+        f.descriptor.extents.resize(extent_count);
+
+        for (auto&& extent : f.descriptor.extents)
+        {
+            consume(&data, &extent);
+        }
+
+        m_files[cache_id] = std::move(f);
+    }
+}
+
+void manifest::add_record(const file& file, std::string* records)
+{
+    append(record_type::add, records);
+    append(file.descriptor.cache_id, records);
+    append(file.owner, records);
+    append(file.descriptor.size, records);
+    append(static_cast<uint32_t>(file.descriptor.extents.size()), records);
+
+    for (auto&& extent : file.descriptor.extents)
+    {
+        append(extent, records);
+    }
+}
+
+uint32_t manifest::region_of(uint64_t generation)
+{
+    return (generation & 1) * region_pages;
+}
+
+uint32_t manifest::pages_for(uint32_t size)
+{
+    return (sizeof(header) + size + page_mask) >> page_bits;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+
+#include <gt/condition.h>
+#include <storage/disk.h>
+
+#include <map>
+#include <string>
+
+
+namespace tyrtech::storage {
+
+
+class manifest : private disallow_copy
+{
+public:
+    DEFINE_EXCEPTION(disk::error, error);
+
+public:
+    static constexpr uint32_t region_pages{2048};
+
+public:
+    struct file
+    {
+        uint64_t owner{0};
+        file_descriptor descriptor;
+    };
+
+    using files_t =
+            std::map<uint64_t, file>;
+
+public:
+    const files_t& recover();
+
+    void add(uint64_t owner, const file_descriptor& descriptor);
+    void remove(uint64_t cache_id);
+
+    void commit();
+
+    const files_t& files() const;
+
+public:
+    manifest(disk* disk, bool recover);
+
+private:
+    struct header
+    {
+        uint32_t crc{0};
+        uint32_t size{0};
+        uint64_t generation{0};
+    } __attribute__ ((packed));
+
+    enum class record_type : uint8_t
+    {
+        add = 1,
+        remove = 2
+    };
+
+private:
+    disk* m_disk{nullptr};
+    uint32_t m_disk_pages{0};
+
+    bool m_recover{false};
+    bool m_recovered{false};
+
+    files_t m_files;
+
+    uint64_t m_generation{0};
+    uint32_t m_page{0};
+
+    std::string m_records;
+
+    uint64_t m_sequence{0};
+    uint64_t m_commited_sequence{0};
+
+    bool m_commit_in_progress{false};
+    gt::condition m_commit_cond;
+
+private:
+    void format();
+    void checkpoint();
+    void restore_records(std::string* records);
+
+    std::string snapshot() const;
+
+    void write_batch(uint32_t page, uint64_t generation, const std::string& records);
+    uint32_t read_batch(uint32_t page, uint64_t* generation, std::string* records);
+
+    void replay(const std::string_view& records);
+
+    static void add_record(const file& file, std::string* records);
+
+    static uint32_t region_of(uint64_t generation);
+    static uint32_t pages_for(uint32_t size);
+};
+
+}
@@ -0,0 +1,192 @@
+#include <common/branch_prediction.h>
+#include <storage/wal.h>
+
+#include <crc32c.h>
+#include <cstring>
+#include <limits.h>
+
+
+namespace tyrtech::storage {
+
+
+wal::records_t wal::recover()
+{
+    assert(likely(m_recovered == false));
+    m_recovered = true;
+
+    records_t records;
+
+    uint64_t file_size = m_file.stat().st_size;
+    uint64_t lsn = 0;
+
+    std::string data;
+
+    while (m_offset + sizeof(header) <= file_size)
+    {
+        header h;
+        m_file.pread(m_offset, reinterpret_cast<char*>(&h), sizeof(h));
+
+        if (m_offset + sizeof(h) + h.size > file_size)
+        {
+            break;
+        }
+
+        if (lsn != 0 && h.lsn != lsn + 1)
+        {
+            break;
+        }
+
+        data.resize(sizeof(h) + h.size);
+        m_file.pread(m_offset, data.data(), data.size());
+
+        uint32_t crc = crc32c_update(0,
+                                     data.data() + sizeof(h.crc),
+                                     data.size() - sizeof(h.crc));
+
+        if (crc != h.crc)
+        {
+            break;
+        }
+
+        if (h.size != 0)
+        {
+            records.emplace_back(data.substr(sizeof(h)));
+        }
+
+        lsn = h.lsn;
+        m_offset += data.size();
+    }
+
+    m_next_lsn = lsn + 1;
+    m_commited_lsn = lsn;
+
+    return records;
+}
+
+uint64_t wal::append(const std::string_view& record)
+{
+    assert(likely(m_recovered == true));
+
+    header h;
+
+    h.size = record.size();
+    h.lsn = m_next_lsn++;
+
+    std::string buffer(sizeof(h) + record.size(), '\0');
+
+    std::memcpy(buffer.data(), &h, sizeof(h));
+    std::memcpy(buffer.data() + sizeof(h), record.data(), record.size());
+
+    h.crc = crc32c_update(0,
+                          buffer.data() + sizeof(h.crc),
+                          buffer.size() - sizeof(h.crc));
+
+    std::memcpy(buffer.data(), &h.crc, sizeof(h.crc));
+
+    m_buffers.emplace_back(std::move(buffer));
+
+    return h.lsn;
+}
+
+void wal::commit(uint64_t lsn)
+{
+    assert(likely(lsn < m_next_lsn));
+
+    while (m_commited_lsn < lsn)
+    {
+        if (m_failed == true)
+        {
+            throw error("{}: write-ahead log failed", m_file.path());
+        }
+
+        if (m_commit_in_progress == true)
+        {
+            m_commit_cond.wait();
+            continue;
+        }
+
+        m_commit_in_progress = true;
+
+        buffers_t buffers;
+        std::swap(buffers, m_buffers);
+
+        uint64_t commited_lsn = m_next_lsn - 1;
+
+        if (m_reset == true)
+        {
+            m_offset = 0;
+            m_reset = false;
+        }
+
+        try
+        {
+            write(&buffers);
+
+            m_file.sync();
+        }
+        catch (...)
+        {
+            m_failed = true;
+
+            m_commit_in_progress = false;
+            m_commit_cond.signal_all();
+
+            throw;
+        }
+
+        m_commited_lsn = commited_lsn;
+
+        m_commit_in_progress = false;
+        m_commit_cond.signal_all();
+    }
+}
+
+void wal::reset()
+{
+    m_reset = true;
+
+    commit(append(std::string_view()));
+}
+
+uint64_t wal::size() const
+{
+    return m_offset;
+}
+
+wal::wal(io::file file)
+  : m_file(std::move(file))
+{
+}
+
+void wal::write(buffers_t* buffers)
+{
+    auto it = buffers->begin();
+
+    while (it != buffers->end())
+    {
+        iovec iov[IOV_MAX];
+
+        uint32_t count = 0;
+        uint32_t size = 0;
+
+        while (it != buffers->end() && count < IOV_MAX)
+        {
+            iov[count].iov_base = it->data();
+            iov[count].iov_len = it->size();
+
+            size += it->size();
+            count++;
+
+            ++it;
+        }
+
+        if (m_file.pwritev(m_offset, iov, count) != size)
+        {
+            throw error("{}: unable to write", m_file.path());
+        }
+
+        m_offset += size;
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+
+#include <gt/condition.h>
+#include <io/file.h>
+
+#include <string>
+#include <vector>
+
+
+namespace tyrtech::storage {
+
+
+class wal : private disallow_copy
+{
+public:
+    DEFINE_EXCEPTION(io::file::error, error);
+
+public:
+    using records_t =
+            std::vector<std::string>;
+
+public:
+    records_t recover();
+
+    uint64_t append(const std::string_view& record);
+    void commit(uint64_t lsn);
+
+    void reset();
+
+    uint64_t size() const;
+
+public:
+    wal(io::file file);
+
+private:
+    struct header
+    {
+        uint32_t crc{0};
+        uint32_t size{0};
+        uint64_t lsn{0};
+    } __attribute__ ((packed));
+
+    using buffers_t =
+            std::vector<std::string>;
+
+private:
+    io::file m_file;
+    uint64_t m_offset{0};
+
+    uint64_t m_next_lsn{1};
+    uint64_t m_commited_lsn{0};
+
+    buffers_t m_buffers;
+
+    bool m_recovered{false};
+    bool m_reset{false};
+    bool m_failed{false};
+
+    bool m_commit_in_progress{false};
+    gt::condition m_commit_cond;
+
+private:
+    void write(buffers_t* buffers);
+};
+
+}
@@ -0,0 +1,100 @@
+#include <common/branch_prediction.h>
+#include <tyrdbs/bloom_filter.h>
+
+#include <cassert>
+
+
+namespace tyrtech::tyrdbs {
+
+
+bool bloom_filter::may_contain(const std::string_view& key) const
+{
+    if (m_bits == 0)
+    {
+        return true;
+    }
+
+    uint32_t h = hash(key);
+    uint32_t delta = (h >> 17) | (h << 15);
+
+    for (uint32_t i = 0; i < m_probes; i++)
+    {
+        uint32_t bit = h % m_bits;
+
+        if ((m_data[bit >> 3] & (1U << (bit & 7))) == 0)
+        {
+            return false;
+        }
+
+        h += delta;
+    }
+
+    return true;
+}
+
+uint32_t bloom_filter::size() const
+{
+    return m_data.size();
+}
+
+uint32_t bloom_filter::hash(const std::string_view& key)
+{
+    static constexpr uint32_t m{0xc6a4a793U};
+    static constexpr uint32_t seed{0xbc9f1d34U};
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(key.data());
+    const uint8_t* end = data + key.size();
+
+    uint32_t h = seed ^ (key.size() * m);
+
+    while (data + 4 <= end)
+    {
+        uint32_t w = *reinterpret_cast<const uint32_t*>(data);
+        data += 4;
+
+        h += w;
+        h *= m;
+        h ^= (h >> 16);
+    }
+
+    switch (end - data)
+    {
+        case 3:
+        {
+            h += static_cast<uint32_t>(data[2]) << 16;
+        }
+        [[fallthrough]];
+        case 2:
+        {
+            h += static_cast<uint32_t>(data[1]) << 8;
+        }
+        [[fallthrough]];
+        case 1:
+        {
+            h += data[0];
+            h *= m;
+            h ^= (h >> 24);
+
+            break;
+        }
+    }
+
+    return h;
+}
+
+bloom_filter::bloom_filter(data_t&& data)
+  : m_data(std::move(data))
+{
+    if (m_data.size() < 2)
+    {
+        m_data.clear();
+        return;
+    }
+
+    m_probes = static_cast<uint8_t>(m_data.back());
+    m_bits = (m_data.size() - 1) << 3;
+
+    assert(likely(m_probes != 0));
+}
+
+}
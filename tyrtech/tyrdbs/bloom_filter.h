@@ -0,0 +1,39 @@
+#pragma once
+
+
+#include <common/disallow_copy.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace tyrtech::tyrdbs {
+
+
+class bloom_filter : private disallow_copy
+{
+public:
+    using data_t =
+            std::vector<char>;
+
+public:
+    bool may_contain(const std::string_view& key) const;
+
+    uint32_t size() const;
+
+public:
+    static uint32_t hash(const std::string_view& key);
+
+public:
+    bloom_filter() = default;
+    bloom_filter(data_t&& data);
+
+private:
+    data_t m_data;
+
+    uint32_t m_bits{0};
+    uint32_t m_probes{0};
+};
+
+}
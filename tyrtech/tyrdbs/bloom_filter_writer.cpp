@@ -0,0 +1,64 @@
+#include <tyrdbs/bloom_filter_writer.h>
+
+#include <algorithm>
+
+
+namespace tyrtech::tyrdbs {
+
+
+void bloom_filter_writer::add(const std::string_view& key)
+{
+    if (m_bits_per_key == 0)
+    {
+        return;
+    }
+
+    m_hashes.push_back(bloom_filter::hash(key));
+}
+
+bloom_filter::data_t bloom_filter_writer::flush()
+{
+    bloom_filter::data_t data;
+
+    if (m_hashes.size() == 0)
+    {
+        return data;
+    }
+
+    uint32_t probes = std::clamp(m_bits_per_key * 69 / 100, 1U, 30U);
+
+    uint64_t bits = static_cast<uint64_t>(m_hashes.size()) * m_bits_per_key;
+    bits = std::clamp(bits, 64UL, static_cast<uint64_t>(max_bits));
+
+    uint32_t bytes = (bits + 7) >> 3;
+    bits = static_cast<uint64_t>(bytes) << 3;
+
+    data.resize(bytes + 1, 0);
+
+    for (auto&& hash : m_hashes)
+    {
+        uint32_t h = hash;
+        uint32_t delta = (h >> 17) | (h << 15);
+
+        for (uint32_t i = 0; i < probes; i++)
+        {
+            uint32_t bit = h % bits;
+            data[bit >> 3] |= 1U << (bit & 7);
+
+            h += delta;
+        }
+    }
+
+    data[bytes] = static_cast<char>(probes);
+
+    m_hashes.clear();
+
+    return data;
+}
+
+bloom_filter_writer::bloom_filter_writer(uint32_t bits_per_key)
+  : m_bits_per_key(bits_per_key)
+{
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+
+#include <tyrdbs/bloom_filter.h>
+
+
+namespace tyrtech::tyrdbs {
+
+
+class bloom_filter_writer : private disallow_copy
+{
+public:
+    static constexpr uint32_t max_bits{0x80000000U};
+
+public:
+    void add(const std::string_view& key);
+
+    bloom_filter::data_t flush();
+
+public:
+    bloom_filter_writer(uint32_t bits_per_key);
+
+private:
+    using hashes_t =
+            std::vector<uint32_t>;
+
+private:
+    uint32_t m_bits_per_key{0};
+    hashes_t m_hashes;
+};
+
+}
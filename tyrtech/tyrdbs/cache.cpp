@@ -1,9 +1,11 @@
 #include <common/wtinylfu.h>
+#include <storage/engine.h>
 #include <storage/latch.h>
 #include <tyrdbs/cache.h>
 #include <tyrdbs/location.h>
 
 #include <crc32c.h>
+#include <mutex>
 
 
 namespace tyrtech::tyrdbs::cache {
@@ -13,11 +15,13 @@ struct key
 {
     uint64_t chunk_ndx{static_cast<uint64_t>(-1)};
     uint64_t location{static_cast<uint64_t>(-1)};
+    uint64_t domain{0};
 
     bool operator==(const key& other) const
     {
         return chunk_ndx == other.chunk_ndx &&
-                location == other.location;
+                location == other.location &&
+                domain == other.domain;
     }
 
     bool operator!=(const key& other) const
@@ -34,51 +38,188 @@ struct key_hasher
 
         seed ^= std::hash<uint64_t>()(key.chunk_ndx) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         seed ^= std::hash<uint64_t>()(key.location) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed ^= std::hash<uint64_t>()(key.domain) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
 
         return seed;
     }
 };
 
 
+struct node_weigher
+{
+    static constexpr uint64_t typical_weight{node::page_size >> 1};
+
+    uint64_t operator()(const node_ptr& node) const
+    {
+        return node->memory_size();
+    }
+};
+
+
 using cache_t =
-        wtinylfu<cache::key, node_ptr, cache::key_hasher>;
+        wtinylfu<cache::key, node_ptr, cache::key_hasher, cache::node_weigher>;
 
 using latch_t =
         storage::latch<cache::key, node_ptr, cache::key_hasher>;
 
 
+class shared_cache : private disallow_copy, disallow_move
+{
+public:
+    node_ptr get(const cache::key& key)
+    {
+        auto& s = shard_of(key);
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        return s.cache.get(key);
+    }
+
+    void set(const cache::key& key, node_ptr node)
+    {
+        auto& s = shard_of(key);
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        if (s.cache.get(key) != nullptr)
+        {
+            return;
+        }
+
+        node = s.cache.set(key, node);
+    }
+
+public:
+    shared_cache(uint64_t cache_size, uint32_t shard_bits)
+      : m_sketch(cache_size / node_weigher::typical_weight)
+      , m_shard_mask((1U << shard_bits) - 1)
+    {
+        for (uint32_t i = 0; i < (1U << shard_bits); i++)
+        {
+            m_shards.emplace_back(std::make_unique<shard>(cache_size >> shard_bits,
+                                                          &m_sketch));
+        }
+    }
+
+private:
+    struct shard
+    {
+        std::mutex mutex;
+        cache_t cache;
+
+        shard(uint64_t cache_size, frequency_sketch* sketch)
+          : cache(cache_size, sketch)
+        {
+        }
+    };
+
+    using shard_ptr =
+            std::unique_ptr<shard>;
+
+    using shards_t =
+            std::vector<shard_ptr>;
+
+private:
+    frequency_sketch m_sketch;
+
+    shards_t m_shards;
+    uint64_t m_shard_mask{0};
+
+private:
+    shard& shard_of(const cache::key& key)
+    {
+        uint64_t hash = cache::key_hasher{}(key);
+        return *m_shards[(hash >> 32) & m_shard_mask];
+    }
+};
+
+
+std::unique_ptr<shared_cache> __shared_cache;
+std::once_flag __shared_cache_flag;
+
 thread_local std::unique_ptr<cache_t> __cache;
 thread_local std::unique_ptr<latch_t> __latch;
+thread_local bool __shared{false};
 
 thread_local uint64_t __cache_requests{0};
 thread_local uint64_t __cache_misses{0};
 
 
-void initialize(uint32_t cache_bits)
+void initialize(uint64_t cache_size)
 {
-    if (cache_bits != 0)
+    if (cache_size != 0)
     {
-        __cache = std::make_unique<cache_t>(1U << cache_bits);
+        __cache = std::make_unique<cache_t>(cache_size);
         __latch = std::make_unique<latch_t>();
     }
 }
 
-void set(uint64_t chunk_ndx, uint64_t location, node_ptr node)
+void initialize_shared(uint64_t cache_size, uint32_t shard_bits)
 {
-    if (__cache.get() == nullptr)
+    auto create = [cache_size, shard_bits]
     {
-        return;
-    }
+        __shared_cache = std::make_unique<shared_cache>(cache_size, shard_bits);
+    };
+
+    std::call_once(__shared_cache_flag, create);
 
+    __latch = std::make_unique<latch_t>();
+    __shared = true;
+}
+
+bool enabled()
+{
+    return __latch.get() != nullptr;
+}
+
+cache::key key_of(uint64_t chunk_ndx, uint64_t location)
+{
     cache::key key;
 
     key.chunk_ndx = chunk_ndx;
     key.location = location;
 
-    __cache->set(key, std::move(node));
+    if (__shared == true)
+    {
+        key.domain = storage::id();
+    }
+
+    return key;
+}
+
+node_ptr cache_get(const cache::key& key)
+{
+    if (__shared == true)
+    {
+        return __shared_cache->get(key);
+    }
+
+    return __cache->get(key);
 }
 
-node_ptr load(const storage::file_reader& reader, uint64_t location)
+void cache_set(const cache::key& key, node_ptr node)
+{
+    if (__shared == true)
+    {
+        __shared_cache->set(key, std::move(node));
+    }
+    else
+    {
+        __cache->set(key, std::move(node));
+    }
+}
+
+void set(uint64_t chunk_ndx, uint64_t location, node_ptr node)
+{
+    if (__latch.get() == nullptr)
+    {
+        return;
+    }
+
+    cache_set(key_of(chunk_ndx, location), std::move(node));
+}
+
+node_ptr load(const storage::file_reader& reader,
+              uint64_t location,
+              node::key_encoding key_encoding)
 {
     uint64_t node_offset = location::offset_from(location);
     uint16_t node_size = location::size_from(location);
@@ -103,7 +244,7 @@ node_ptr load(const storage::file_reader& reader, uint64_t location)
 
     auto node = std::make_shared<tyrdbs::node>();
 
-    node->load(data, node_size);
+    node->load(data, node_size, key_encoding);
     data += node_size;
 
     uint64_t offset = location::offset_from(location);
@@ -119,21 +260,21 @@ node_ptr load(const storage::file_reader& reader, uint64_t location)
     return node;
 }
 
-node_ptr get(const storage::file_reader& reader, uint64_t chunk_ndx, uint64_t location)
+node_ptr get(const storage::file_reader& reader,
+             uint64_t chunk_ndx,
+             uint64_t location,
+             node::key_encoding key_encoding)
 {
-    if (__cache.get() == nullptr)
+    if (__latch.get() == nullptr)
     {
-        return load(reader, location);
+        return load(reader, location, key_encoding);
     }
 
-    cache::key cache_key;
-
-    cache_key.chunk_ndx = chunk_ndx;
-    cache_key.location = location;
+    auto cache_key = key_of(chunk_ndx, location);
 
     __cache_requests++;
 
-    auto node = __cache->get(cache_key);
+    auto node = cache_get(cache_key);
 
     if (node != nullptr)
     {
@@ -146,7 +287,7 @@ node_ptr get(const storage::file_reader& reader, uint64_t chunk_ndx, uint64_t lo
     {
         __cache_misses++;
 
-        node = load(reader, location);
+        node = load(reader, location, key_encoding);
 
         __latch->release(cache_key);
     }
@@ -157,7 +298,7 @@ node_ptr get(const storage::file_reader& reader, uint64_t chunk_ndx, uint64_t lo
 
     if (__latch->remove(cache_key) == true)
     {
-        __cache->set(cache_key, node);
+        cache_set(cache_key, node);
     }
 
     return node;
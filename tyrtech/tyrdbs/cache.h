@@ -12,9 +12,15 @@ using node_ptr =
         std::shared_ptr<node>;
 
 
-void initialize(uint32_t cache_bits);
+void initialize(uint64_t cache_size);
+void initialize_shared(uint64_t cache_size, uint32_t shard_bits);
 
-node_ptr get(const storage::file_reader& reader, uint64_t chunk_ndx, uint64_t location);
+bool enabled();
+
+node_ptr get(const storage::file_reader& reader,
+             uint64_t chunk_ndx,
+             uint64_t location,
+             node::key_encoding key_encoding);
 void set(uint64_t chunk_ndx, uint64_t location, node_ptr node);
 
 }
@@ -31,4 +31,13 @@ void key_buffer::assign(const std::string_view& other)
     m_size = other.size();
 }
 
+void key_buffer::assign(uint32_t shared_size, const std::string_view& suffix)
+{
+    assert(likely(shared_size <= m_size));
+    assert(likely(shared_size + suffix.size() <= m_data.size()));
+
+    std::memcpy(m_data.data() + shared_size, suffix.data(), suffix.size());
+    m_size = shared_size + suffix.size();
+}
+
 }
@@ -15,6 +15,7 @@ public:
 
     void clear();
     void assign(const std::string_view& other);
+    void assign(uint32_t shared_size, const std::string_view& suffix);
 
 public:
     key_buffer() noexcept = default;
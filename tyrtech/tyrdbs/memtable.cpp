@@ -0,0 +1,397 @@
+#include <common/branch_prediction.h>
+#include <tyrdbs/memtable.h>
+
+#include <cassert>
+#include <cstring>
+
+
+namespace tyrtech::tyrdbs {
+
+
+class memtable_iterator : public iterator
+{
+public:
+    bool next() override;
+
+    std::string_view key() const override;
+    std::string_view value() const override;
+    bool eor() const override;
+    bool deleted() const override;
+    uint64_t idx() const override;
+
+public:
+    memtable_iterator(std::shared_ptr<memtable> memtable,
+                      const memtable::entry* entry,
+                      const std::string_view& max_key,
+                      bool single_key);
+
+private:
+    std::shared_ptr<memtable> m_memtable;
+    const memtable::entry* m_entry{nullptr};
+
+    std::string_view m_value;
+    uint32_t m_part_size{0};
+
+    uint64_t m_idx{0};
+    bool m_deleted{false};
+
+    key_buffer m_max_key;
+    bool m_bounded{false};
+
+    bool m_single_key{false};
+    bool m_started{false};
+
+private:
+    void set_entry(const memtable::entry* entry);
+};
+
+bool memtable_iterator::next()
+{
+    if (m_entry == nullptr)
+    {
+        return false;
+    }
+
+    if (m_started == false)
+    {
+        m_started = true;
+        return true;
+    }
+
+    if (m_part_size < m_value.size())
+    {
+        m_value.remove_prefix(m_part_size);
+        m_part_size = std::min(m_value.size(), static_cast<size_t>(memtable::max_value_part_size));
+
+        return true;
+    }
+
+    const memtable::entry* entry = m_entry->next[0];
+
+    if (m_single_key == true || entry == nullptr)
+    {
+        m_entry = nullptr;
+        return false;
+    }
+
+    if (m_bounded == true && entry->get_key().compare(m_max_key.data()) > 0)
+    {
+        m_entry = nullptr;
+        return false;
+    }
+
+    set_entry(entry);
+
+    return true;
+}
+
+std::string_view memtable_iterator::key() const
+{
+    return m_entry->get_key();
+}
+
+std::string_view memtable_iterator::value() const
+{
+    return m_value.substr(0, m_part_size);
+}
+
+bool memtable_iterator::eor() const
+{
+    return m_part_size == m_value.size();
+}
+
+bool memtable_iterator::deleted() const
+{
+    return m_deleted;
+}
+
+uint64_t memtable_iterator::idx() const
+{
+    return m_idx;
+}
+
+memtable_iterator::memtable_iterator(std::shared_ptr<memtable> memtable,
+                                     const memtable::entry* entry,
+                                     const std::string_view& max_key,
+                                     bool single_key)
+  : m_memtable(std::move(memtable))
+  , m_single_key(single_key)
+{
+    assert(likely(entry != nullptr));
+
+    if (max_key.size() != 0)
+    {
+        m_max_key.assign(max_key);
+        m_bounded = true;
+    }
+
+    set_entry(entry);
+}
+
+void memtable_iterator::set_entry(const memtable::entry* entry)
+{
+    m_entry = entry;
+
+    m_value = entry->get_value();
+    m_idx = entry->idx;
+    m_deleted = entry->deleted;
+
+    m_part_size = std::min(m_value.size(), static_cast<size_t>(memtable::max_value_part_size));
+}
+
+std::string_view memtable::entry::get_key() const
+{
+    return std::string_view(key, key_size);
+}
+
+std::string_view memtable::entry::get_value() const
+{
+    return std::string_view(value, value_size);
+}
+
+std::unique_ptr<iterator> memtable::range(const std::string_view& min_key,
+                                          const std::string_view& max_key)
+{
+    assert(likely(min_key.compare(max_key) <= 0));
+
+    entry* e = lower_bound(min_key, nullptr);
+
+    if (e == nullptr || e->get_key().compare(max_key) > 0)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<memtable_iterator>(shared_from_this(), e, max_key, false);
+}
+
+std::unique_ptr<iterator> memtable::begin()
+{
+    entry* e = m_head->next[0];
+
+    if (e == nullptr)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<memtable_iterator>(shared_from_this(), e, std::string_view(), false);
+}
+
+std::unique_ptr<iterator> memtable::get(const std::string_view& key)
+{
+    entry* e = lower_bound(key, nullptr);
+
+    if (e == nullptr || e->get_key().compare(key) != 0)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<memtable_iterator>(shared_from_this(), e, key, true);
+}
+
+void memtable::add(iterator* it)
+{
+    while (it->next() == true)
+    {
+        add(it->key(), it->value(), it->eor(), it->deleted(), it->idx());
+    }
+}
+
+void memtable::add(const std::string_view& key,
+                   const std::string_view& value,
+                   bool eor,
+                   bool deleted,
+                   uint64_t idx)
+{
+    assert(likely(key.size() != 0));
+    assert(likely(key.size() < node::max_key_size));
+
+    if (m_key.size() != 0)
+    {
+        assert(likely(key.compare(m_key.data()) == 0));
+        m_value.append(value.data(), value.size());
+    }
+    else if (eor == false)
+    {
+        m_key.assign(key);
+        m_value.assign(value.data(), value.size());
+    }
+
+    if (eor == false)
+    {
+        return;
+    }
+
+    if (m_key.size() != 0)
+    {
+        insert(key, m_value, deleted, idx);
+
+        m_key.clear();
+        m_value.clear();
+    }
+    else
+    {
+        insert(key, value, deleted, idx);
+    }
+}
+
+uint64_t memtable::size() const
+{
+    return m_size;
+}
+
+uint64_t memtable::key_count() const
+{
+    return m_key_count;
+}
+
+uint64_t memtable::max_idx() const
+{
+    return m_max_idx;
+}
+
+memtable::memtable()
+{
+    m_head = new_entry(max_height);
+}
+
+void memtable::insert(const std::string_view& key,
+                      const std::string_view& value,
+                      bool deleted,
+                      uint64_t idx)
+{
+    entry* prev[max_height];
+    entry* e = lower_bound(key, prev);
+
+    m_max_idx = std::max(m_max_idx, idx);
+
+    if (e != nullptr && e->get_key().compare(key) == 0)
+    {
+        if (e->idx > idx)
+        {
+            return;
+        }
+
+        e->value = copy(value);
+        e->value_size = value.size();
+        e->deleted = deleted;
+        e->idx = idx;
+
+        return;
+    }
+
+    uint8_t height = random_height();
+
+    for (uint8_t level = m_height; level < height; level++)
+    {
+        prev[level] = m_head;
+    }
+
+    m_height = std::max(m_height, height);
+
+    e = new_entry(height);
+
+    e->key = copy(key);
+    e->key_size = key.size();
+    e->value = copy(value);
+    e->value_size = value.size();
+    e->deleted = deleted;
+    e->idx = idx;
+
+    for (uint8_t level = 0; level < height; level++)
+    {
+        e->next[level] = prev[level]->next[level];
+        prev[level]->next[level] = e;
+    }
+
+    m_key_count++;
+}
+
+memtable::entry* memtable::lower_bound(const std::string_view& key, entry** prev) const
+{
+    entry* e = m_head;
+
+    for (int32_t level = m_height - 1; level >= 0; level--)
+    {
+        while (e->next[level] != nullptr && e->next[level]->get_key().compare(key) < 0)
+        {
+            e = e->next[level];
+        }
+
+        if (prev != nullptr)
+        {
+            prev[level] = e;
+        }
+    }
+
+    return e->next[0];
+}
+
+memtable::entry* memtable::new_entry(uint8_t height)
+{
+    uint32_t size = sizeof(entry) + (height - 1) * sizeof(entry*);
+
+    entry* e = new (allocate(size, alignof(entry))) entry();
+
+    e->height = height;
+
+    for (uint8_t level = 0; level < height; level++)
+    {
+        e->next[level] = nullptr;
+    }
+
+    return e;
+}
+
+const char* memtable::copy(const std::string_view& data)
+{
+    char* buffer = allocate(data.size(), 1);
+    std::memcpy(buffer, data.data(), data.size());
+
+    return buffer;
+}
+
+char* memtable::allocate(uint32_t size, uint32_t alignment)
+{
+    m_size += size;
+
+    if (size > (block_size >> 2))
+    {
+        auto it = m_blocks.empty() == true ? m_blocks.end() : m_blocks.end() - 1;
+        return m_blocks.emplace(it, new char[size])->get();
+    }
+
+    uint32_t offset = (m_block_offset + alignment - 1) & ~(alignment - 1);
+
+    if (offset + size > block_size)
+    {
+        m_blocks.emplace_back(new char[block_size]);
+        offset = 0;
+    }
+
+    m_block_offset = offset + size;
+
+    return m_blocks.back().get() + offset;
+}
+
+uint8_t memtable::random_height()
+{
+    uint8_t height = 1;
+
+    while (height < max_height)
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 7;
+        m_seed ^= m_seed << 17;
+
+        if ((m_seed & 3) != 0)
+        {
+            break;
+        }
+
+        height++;
+    }
+
+    return height;
+}
+
+}
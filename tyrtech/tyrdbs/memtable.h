@@ -0,0 +1,98 @@
+#pragma once
+
+
+#include <tyrdbs/iterator.h>
+#include <tyrdbs/key_buffer.h>
+
+#include <memory>
+#include <vector>
+
+
+namespace tyrtech::tyrdbs {
+
+
+class memtable : public std::enable_shared_from_this<memtable>, private disallow_copy, disallow_move
+{
+public:
+    static constexpr uint32_t max_height{16};
+    static constexpr uint32_t block_size{65536};
+    static constexpr uint32_t max_value_part_size{16384};
+
+public:
+    std::unique_ptr<iterator> range(const std::string_view& min_key,
+                                    const std::string_view& max_key);
+    std::unique_ptr<iterator> begin();
+    std::unique_ptr<iterator> get(const std::string_view& key);
+
+    void add(iterator* it);
+    void add(const std::string_view& key,
+             const std::string_view& value,
+             bool eor,
+             bool deleted,
+             uint64_t idx);
+
+    uint64_t size() const;
+    uint64_t key_count() const;
+    uint64_t max_idx() const;
+
+public:
+    memtable();
+
+private:
+    struct entry
+    {
+        const char* key{nullptr};
+        const char* value{nullptr};
+
+        uint32_t value_size{0};
+        uint16_t key_size{0};
+
+        uint8_t height{0};
+        bool deleted{false};
+
+        uint64_t idx{0};
+
+        entry* next[1];
+
+        std::string_view get_key() const;
+        std::string_view get_value() const;
+    };
+
+    using blocks_t =
+            std::vector<std::unique_ptr<char[]>>;
+
+private:
+    blocks_t m_blocks;
+    uint32_t m_block_offset{block_size};
+
+    uint64_t m_size{0};
+    uint64_t m_key_count{0};
+    uint64_t m_max_idx{0};
+
+    entry* m_head{nullptr};
+    uint8_t m_height{1};
+
+    uint64_t m_seed{0x2545f4914f6cdd1dULL};
+
+    key_buffer m_key;
+    std::string m_value;
+
+private:
+    void insert(const std::string_view& key,
+                const std::string_view& value,
+                bool deleted,
+                uint64_t idx);
+
+    entry* lower_bound(const std::string_view& key, entry** prev) const;
+
+    entry* new_entry(uint8_t height);
+    const char* copy(const std::string_view& data);
+
+    char* allocate(uint32_t size, uint32_t alignment);
+    uint8_t random_height();
+
+private:
+    friend class memtable_iterator;
+};
+
+}
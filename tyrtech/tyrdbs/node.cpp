@@ -1,29 +1,53 @@
 #include <common/branch_prediction.h>
 #include <common/exception.h>
 #include <tyrdbs/node.h>
+#include <tyrdbs/key_buffer.h>
+#include <tyrdbs/attributes.h>
 
 #include <lz4.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <cassert>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 
 namespace tyrtech::tyrdbs {
 
 
-void node::load(const char* source, uint32_t source_size)
+thread_local std::array<char, node::node_size> node_buffer;
+
+
+void node::load(const char* source, uint32_t source_size, key_encoding encoding)
 {
     assert(likely(m_key_count == static_cast<uint16_t>(-1)));
 
     int32_t r = LZ4_decompress_safe(source,
-                                    m_data.data(),
+                                    node_buffer.data(),
                                     source_size,
-                                    m_data.size());
+                                    node_buffer.size());
 
-    if (r != static_cast<int32_t>(m_data.size()))
+    if (r != static_cast<int32_t>(node_buffer.size()))
     {
         throw runtime_error("unable to decompress node");
     }
 
-    m_key_count = *reinterpret_cast<const uint16_t*>(m_data.data());
+    m_key_encoding = encoding;
+
+    assign(node_buffer.data());
+}
+
+uint64_t node::memory_size() const
+{
+    uint64_t size = sizeof(node);
+
+    size += m_data_size;
+    size += m_prefix_buffer.capacity() * sizeof(int32_t);
+
+    return size;
 }
 
 uint64_t node::get_next() const
@@ -42,11 +66,35 @@ uint16_t node::key_count() const
     return m_key_count;
 }
 
-std::string_view node::key_at(uint16_t ndx) const
+std::string_view node::key_at(uint16_t ndx, key_buffer* buffer) const
 {
-    const entry* entry = entry_at(ndx);
+    if (m_key_encoding == key_encoding::plain)
+    {
+        return stored_key_at(ndx);
+    }
+
+    uint16_t restart_ndx = ndx - (ndx % restart_interval);
+
+    buffer->assign(stored_key_at(restart_ndx));
+
+    for (uint16_t i = restart_ndx + 1; i <= ndx; i++)
+    {
+        buffer->assign(shared_size_at(i), stored_key_at(i));
+    }
+
+    return buffer->data();
+}
+
+std::string_view node::next_key_at(uint16_t ndx, key_buffer* buffer) const
+{
+    if (m_key_encoding == key_encoding::plain)
+    {
+        return stored_key_at(ndx);
+    }
+
+    buffer->assign(shared_size_at(ndx), stored_key_at(ndx));
 
-    return std::string_view(m_data.data() + entry->key_offset, entry->key_size);
+    return buffer->data();
 }
 
 std::string_view node::value_at(uint16_t ndx) const
@@ -56,7 +104,7 @@ std::string_view node::value_at(uint16_t ndx) const
     uint16_t offset = entry->key_offset;
     offset -= entry->value_size;
 
-    return std::string_view(m_data.data() + offset, entry->value_size);
+    return std::string_view(data_at(offset), entry->value_size);
 }
 
 bool node::eor_at(uint16_t ndx) const
@@ -71,39 +119,122 @@ bool node::deleted_at(uint16_t ndx) const
 
 uint16_t node::lower_bound(const std::string_view& key) const
 {
-    uint16_t start = 0;
-    uint16_t end = key_count();
+    uint16_t block = lower_bound_from(key);
 
-    while (end - start > 8)
+    if (m_key_encoding == key_encoding::plain)
     {
-        uint16_t ndx = ((end - start) >> 1) + start;
+        return block;
+    }
+
+    if (block == 0)
+    {
+        return 0;
+    }
+
+    uint16_t restart_ndx = (block - 1) * restart_interval;
+    uint16_t last_ndx = std::min(static_cast<uint16_t>(restart_ndx + restart_interval),
+                                 key_count());
 
-        int32_t cmp = key.compare(key_at(ndx));
+    uint16_t matched_size = common_size_of(key, stored_key_at(restart_ndx));
 
-        if (cmp <= 0)
+    for (uint16_t ndx = restart_ndx + 1; ndx < last_ndx; ndx++)
+    {
+        uint16_t shared_size = shared_size_at(ndx);
+
+        if (shared_size > matched_size)
         {
-            end = ndx;
+            continue;
         }
-        else
+
+        if (shared_size < matched_size)
         {
-            start = ndx;
+            return ndx;
         }
-    }
 
-    for (uint16_t ndx = start; ndx < end; ndx++)
-    {
-        if (key.compare(key_at(ndx)) <= 0)
+        auto suffix = stored_key_at(ndx);
+        auto key_suffix = key.substr(matched_size);
+
+        uint16_t size = common_size_of(key_suffix, suffix);
+
+        if (size == key_suffix.size())
         {
             return ndx;
         }
+
+        if (size != suffix.size() &&
+            static_cast<uint8_t>(suffix[size]) > static_cast<uint8_t>(key_suffix[size]))
+        {
+            return ndx;
+        }
+
+        matched_size += size;
+    }
+
+    return last_ndx;
+}
+
+void node::assign(const char* data)
+{
+    uint16_t key_count = *reinterpret_cast<const uint16_t*>(data);
+
+    m_key_count = key_count & ~prefixes_flag;
+
+    uint32_t header_size = sizeof(key_count) + m_key_count * sizeof(entry);
+
+    if ((key_count & prefixes_flag) != 0)
+    {
+        header_size += sizeof(m_common_size) + prefix_count() * sizeof(int32_t);
+    }
+
+    if (header_size > node_size)
+    {
+        throw runtime_error("invalid node prefixes");
+    }
+
+    constexpr int32_t attributes_size = std::max(sizeof(data_attributes),
+                                                 sizeof(index_attributes));
+
+    int32_t data_offset = node_size;
+
+    for (uint16_t ndx = 0; ndx < m_key_count; ndx++)
+    {
+        auto e = reinterpret_cast<const entry*>(data + sizeof(key_count) + ndx * sizeof(entry));
+        data_offset = std::min(data_offset, e->key_offset - e->value_size - attributes_size);
     }
 
-    return end;
+    data_offset = std::max(data_offset, static_cast<int32_t>(header_size));
+
+    m_data_size = header_size + node_size - data_offset;
+    m_data_gap = data_offset - header_size;
+
+    m_buffer.reset(new char[m_data_size]);
+
+    std::memcpy(m_buffer.get(), data, header_size);
+    std::memcpy(m_buffer.get() + header_size, data + data_offset, node_size - data_offset);
+
+    m_data = m_buffer.get();
+
+    if ((key_count & prefixes_flag) != 0)
+    {
+        uint16_t offset = sizeof(key_count) + m_key_count * sizeof(entry);
+
+        m_common_size = *reinterpret_cast<const uint16_t*>(m_data + offset);
+        m_prefixes = reinterpret_cast<const int32_t*>(m_data + offset + sizeof(m_common_size));
+    }
+    else
+    {
+        build_prefixes();
+    }
+}
+
+const char* node::data_at(uint16_t offset) const
+{
+    return m_data + offset - m_data_gap;
 }
 
 const node::entry* node::entry_at(uint16_t ndx) const
 {
-    const char* data = m_data.data();
+    const char* data = m_data;
 
     data += sizeof(m_key_count);
     data += ndx << 1;
@@ -112,4 +243,192 @@ const node::entry* node::entry_at(uint16_t ndx) const
     return reinterpret_cast<const entry*>(data);
 }
 
+std::string_view node::stored_key_at(uint16_t ndx) const
+{
+    const entry* entry = entry_at(ndx);
+
+    return std::string_view(data_at(entry->key_offset), entry->key_size);
+}
+
+uint16_t node::shared_size_at(uint16_t ndx) const
+{
+    if (ndx % restart_interval == 0)
+    {
+        return 0;
+    }
+
+    const entry* entry = entry_at(ndx);
+
+    return *reinterpret_cast<const uint16_t*>(data_at(entry->key_offset + entry->key_size));
+}
+
+int32_t node::prefix_of(const std::string_view& key)
+{
+    uint32_t prefix = 0;
+
+    for (uint32_t i = 0; i < sizeof(prefix); i++)
+    {
+        prefix <<= 8;
+
+        if (i < key.size())
+        {
+            prefix |= static_cast<uint8_t>(key[i]);
+        }
+    }
+
+    return static_cast<int32_t>(prefix ^ 0x80000000U);
+}
+
+uint16_t node::common_size_of(const std::string_view& key1, const std::string_view& key2)
+{
+    uint16_t size = std::min(key1.size(), key2.size());
+    uint16_t common_size = 0;
+
+    while (common_size < size && key1[common_size] == key2[common_size])
+    {
+        common_size++;
+    }
+
+    return common_size;
+}
+
+uint16_t node::common_size() const
+{
+    if (key_count() == 0)
+    {
+        return 0;
+    }
+
+    auto first_key = stored_key_at(0);
+    auto last_key = stored_key_at((prefix_count() - 1) * prefix_stride());
+
+    return common_size_of(first_key, last_key);
+}
+
+void node::build_prefixes()
+{
+    uint16_t stride = prefix_stride();
+
+    m_common_size = common_size();
+    m_prefix_buffer.resize(prefix_count());
+
+    for (uint16_t i = 0; i < m_prefix_buffer.size(); i++)
+    {
+        m_prefix_buffer[i] = prefix_of(stored_key_at(i * stride).substr(m_common_size));
+    }
+
+    m_prefixes = m_prefix_buffer.data();
+}
+
+uint16_t node::prefix_stride() const
+{
+    if (m_key_encoding == key_encoding::prefix)
+    {
+        return restart_interval;
+    }
+
+    return 1;
+}
+
+uint16_t node::prefix_count() const
+{
+    uint16_t stride = prefix_stride();
+
+    return (key_count() + stride - 1) / stride;
+}
+
+uint16_t node::lower_bound_from(const std::string_view& key) const
+{
+    if (key_count() == 0)
+    {
+        return 0;
+    }
+
+    int32_t cmp = key.substr(0, m_common_size).compare(stored_key_at(0).substr(0, m_common_size));
+
+    if (cmp < 0)
+    {
+        return 0;
+    }
+
+    if (cmp > 0)
+    {
+        return prefix_count();
+    }
+
+    int32_t prefix = prefix_of(key.substr(m_common_size));
+
+    uint16_t start = count_less(prefix, 0, prefix_count());
+    uint16_t end = prefix_count();
+
+    if (prefix != std::numeric_limits<int32_t>::max())
+    {
+        end = count_less(prefix + 1, start, end);
+    }
+
+    uint16_t stride = prefix_stride();
+
+    while (start < end)
+    {
+        uint16_t ndx = ((end - start) >> 1) + start;
+
+        if (key.compare(stored_key_at(ndx * stride)) <= 0)
+        {
+            end = ndx;
+        }
+        else
+        {
+            start = ndx + 1;
+        }
+    }
+
+    return start;
+}
+
+uint16_t node::count_less(int32_t prefix, uint16_t start, uint16_t end) const
+{
+    const int32_t* prefixes = m_prefixes;
+
+    while (end - start > 64)
+    {
+        uint16_t ndx = ((end - start) >> 1) + start;
+
+        if (prefixes[ndx] < prefix)
+        {
+            start = ndx + 1;
+        }
+        else
+        {
+            end = ndx;
+        }
+    }
+
+    uint16_t ndx = start;
+
+#if defined(__AVX2__)
+    __m256i p = _mm256_set1_epi32(prefix);
+
+    for (; ndx + 8 <= end; ndx += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefixes + ndx));
+        uint32_t mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(p, v)));
+
+        if (mask != 0xff)
+        {
+            return ndx + __builtin_popcount(mask);
+        }
+    }
+#endif
+
+    for (; ndx < end; ndx++)
+    {
+        if (prefixes[ndx] >= prefix)
+        {
+            break;
+        }
+    }
+
+    return ndx;
+}
+
 }
@@ -5,21 +5,37 @@
 #include <common/disallow_move.h>
 
 #include <string>
+#include <vector>
 #include <array>
+#include <memory>
 
 
 namespace tyrtech::tyrdbs {
 
 
+class key_buffer;
+
+
 class node : private disallow_copy, disallow_move
 {
 public:
     static constexpr uint32_t page_size{8192};
     static constexpr uint32_t node_size{(page_size - 32) * 255 / 256};
     static constexpr uint32_t max_key_size{1024};
+    static constexpr uint16_t restart_interval{16};
+    static constexpr uint16_t prefixes_flag{0x8000};
+
+public:
+    enum class key_encoding : uint8_t
+    {
+        plain = 0,
+        prefix = 1
+    };
 
 public:
-    void load(const char* source, uint32_t source_size);
+    void load(const char* source, uint32_t source_size, key_encoding encoding);
+
+    uint64_t memory_size() const;
 
     uint64_t get_next() const;
     void set_next(uint64_t next_node);
@@ -35,10 +51,11 @@ public:
         offset -= entry->value_size;
         offset -= sizeof(Attributes);
 
-        return reinterpret_cast<const Attributes*>(m_data.data() + offset);
+        return reinterpret_cast<const Attributes*>(data_at(offset));
     }
 
-    std::string_view key_at(uint16_t ndx) const;
+    std::string_view key_at(uint16_t ndx, key_buffer* buffer) const;
+    std::string_view next_key_at(uint16_t ndx, key_buffer* buffer) const;
     std::string_view value_at(uint16_t ndx) const;
     bool eor_at(uint16_t ndx) const;
     bool deleted_at(uint16_t ndx) const;
@@ -60,17 +77,51 @@ private:
     using data_t =
             std::array<char, node_size>;
 
+    using buffer_t =
+            std::unique_ptr<char[]>;
+
+    using prefixes_t =
+            std::vector<int32_t>;
+
 private:
-    data_t m_data;
+    buffer_t m_buffer;
+
+    const char* m_data{nullptr};
+    uint16_t m_data_size{0};
+    uint16_t m_data_gap{0};
+
+    uint16_t m_common_size{0};
+
+    const int32_t* m_prefixes{nullptr};
+    prefixes_t m_prefix_buffer;
 
     uint16_t m_key_count{static_cast<uint16_t>(-1)};
     uint64_t m_next_node{static_cast<uint64_t>(-1)};
 
+    key_encoding m_key_encoding{key_encoding::plain};
+
 private:
+    void assign(const char* data);
+
+    const char* data_at(uint16_t offset) const;
     const entry* entry_at(uint16_t ndx) const;
 
+    std::string_view stored_key_at(uint16_t ndx) const;
+    uint16_t shared_size_at(uint16_t ndx) const;
+
+    static int32_t prefix_of(const std::string_view& key);
+    static uint16_t common_size_of(const std::string_view& key1, const std::string_view& key2);
+
+    uint16_t common_size() const;
+    void build_prefixes();
+
+    uint16_t prefix_stride() const;
+    uint16_t prefix_count() const;
+    uint16_t lower_bound_from(const std::string_view& key) const;
+    uint16_t count_less(int32_t prefix, uint16_t start, uint16_t end) const;
+
 private:
     friend class node_writer;
-} __attribute__ ((packed));
+};
 
 }
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <cstring>
+#include <algorithm>
 #include <lz4.h>
 
 
@@ -18,7 +19,9 @@ uint32_t node_writer::flush(char* sink, uint32_t sink_size)
 
     assert(likely(sink_size >= LZ4_COMPRESSBOUND(node::node_size)));
 
-    *reinterpret_cast<uint16_t*>(m_data->data()) = m_key_count;
+    write_prefixes();
+
+    *reinterpret_cast<uint16_t*>(m_data->data()) = m_key_count | node::prefixes_flag;
 
     int32_t r = LZ4_compress_default(m_data->data(),
                                      sink,
@@ -33,10 +36,16 @@ uint32_t node_writer::flush(char* sink, uint32_t sink_size)
     return r;
 }
 
+node_writer::node_writer(node::key_encoding key_encoding)
+  : m_key_encoding(key_encoding)
+  , m_data(std::make_unique<node::data_t>())
+{
+}
+
 std::shared_ptr<node> node_writer::reset()
 {
     assert(likely(m_node != nullptr));
-    m_node->m_key_count = m_key_count;
+    m_node->assign(m_data->data());
 
     return std::move(m_node);
 }
@@ -45,13 +54,53 @@ void node_writer::internal_reset()
 {
     m_node = std::make_shared<node>();
 
-    m_data = &m_node->m_data;
+    m_node->m_key_encoding = m_key_encoding;
+
+    m_node->m_data = m_data->data();
     m_data->fill(0);
 
     m_entry_offset = sizeof(node::m_key_count);
     m_data_offset = m_data->size();
 
     m_key_count = 0;
+    m_prefix_size = sizeof(uint16_t);
+}
+
+uint16_t node_writer::shared_size_for(const std::string_view& key) const
+{
+    if (m_key_encoding == node::key_encoding::plain)
+    {
+        return 0;
+    }
+
+    if (m_key_count % node::restart_interval == 0)
+    {
+        return 0;
+    }
+
+    return node::common_size_of(key, m_last_key.data());
+}
+
+void node_writer::write_prefixes()
+{
+    uint16_t stride = m_node->prefix_stride();
+
+    assert(likely(m_entry_offset + m_prefix_size <= m_data_offset));
+    char* data = m_data->data() + m_entry_offset;
+
+    m_node->m_key_count = m_key_count;
+    m_node->m_common_size = m_node->common_size();
+
+    *reinterpret_cast<uint16_t*>(data) = m_node->m_common_size;
+    int32_t* prefixes = reinterpret_cast<int32_t*>(data + sizeof(uint16_t));
+
+    for (uint16_t ndx = 0; ndx < m_key_count; ndx += stride)
+    {
+        auto key = m_node->stored_key_at(ndx).substr(m_node->m_common_size);
+        *prefixes++ = node::prefix_of(key);
+    }
+
+    m_node->m_prefixes = reinterpret_cast<const int32_t*>(data + sizeof(uint16_t));
 }
 
 node::entry* node_writer::next_entry()
@@ -66,7 +115,7 @@ node::entry* node_writer::next_entry()
 
 void node_writer::allocate(uint16_t size)
 {
-    assert(likely(m_entry_offset + size <= m_data_offset));
+    assert(likely(m_entry_offset + m_prefix_size + size <= m_data_offset));
     m_data_offset -= size;
 }
 
@@ -84,7 +133,7 @@ std::string_view node_writer::copy(const std::string_view& value, uint16_t reser
     uint32_t available_space;
 
     available_space = m_data_offset;
-    available_space -= m_entry_offset + reserved_space;
+    available_space -= m_entry_offset + m_prefix_size + reserved_space;
 
     uint16_t partial_size = std::min(static_cast<size_t>(available_space), value.size());
 
@@ -3,6 +3,7 @@
 
 #include <common/branch_prediction.h>
 #include <tyrdbs/node.h>
+#include <tyrdbs/key_buffer.h>
 
 #include <cassert>
 
@@ -29,14 +30,41 @@ public:
             internal_reset();
         }
 
-        if (has_enough_space<Attributes>(key, value, no_split) == false)
+        uint16_t shared_size = shared_size_for(key);
+        uint16_t reserved_size = 0;
+
+        if (m_key_encoding == node::key_encoding::prefix &&
+            m_key_count % node::restart_interval != 0)
+        {
+            reserved_size = sizeof(shared_size);
+        }
+
+        uint16_t prefix_size = 0;
+
+        if (m_key_count % m_node->prefix_stride() == 0)
+        {
+            prefix_size = sizeof(int32_t);
+        }
+
+        auto suffix = key.substr(shared_size);
+
+        if (has_enough_space<Attributes>(suffix,
+                                         value,
+                                         reserved_size + prefix_size,
+                                         no_split) == false)
         {
             return -1;
         }
 
         node::entry* entry = next_entry();
+        m_prefix_size += prefix_size;
 
-        auto&& copied_key = copy(key);
+        if (reserved_size != 0)
+        {
+            copy(shared_size);
+        }
+
+        auto&& copied_key = copy(suffix);
         auto&& copied_value = copy(value, sizeof(attributes));
 
         copy(attributes);
@@ -47,29 +75,43 @@ public:
         entry->eor = eor && value.size() == copied_value.size();
         entry->deleted = deleted;
 
+        if (m_key_encoding == node::key_encoding::prefix)
+        {
+            m_last_key.assign(key);
+        }
+
         return copied_value.size();
     }
 
     uint32_t flush(char* sink, uint32_t sink_size);
     std::shared_ptr<node> reset();
 
+public:
+    node_writer(node::key_encoding key_encoding);
+
 private:
+    node::key_encoding m_key_encoding{node::key_encoding::plain};
+
     std::shared_ptr<node> m_node;
 
-    node::data_t* m_data{nullptr};
+    std::unique_ptr<node::data_t> m_data;
 
     uint16_t m_entry_offset{0};
     uint16_t m_data_offset{0};
 
     uint16_t m_key_count{0};
+    uint16_t m_prefix_size{0};
+
+    key_buffer m_last_key;
 
 private:
     template<typename Attributes>
     bool has_enough_space(const std::string_view& key,
                           const std::string_view& value,
+                          uint16_t reserved_size,
                           bool no_split)
     {
-        uint16_t required_size = 0;
+        uint16_t required_size = reserved_size;
 
         required_size += sizeof(node::entry);
         required_size += key.size();
@@ -84,7 +126,7 @@ private:
             required_size += value.size();
         }
 
-        if (m_data_offset - m_entry_offset < required_size)
+        if (m_data_offset - m_entry_offset - m_prefix_size < required_size)
         {
             return false;
         }
@@ -102,6 +144,10 @@ private:
 
     void internal_reset();
 
+    uint16_t shared_size_for(const std::string_view& key) const;
+
+    void write_prefixes();
+
     node::entry* next_entry();
 
     void allocate(uint16_t size);
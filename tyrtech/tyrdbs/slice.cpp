@@ -1,6 +1,8 @@
+#include <gt/engine.h>
 #include <tyrdbs/slice.h>
 #include <tyrdbs/cache.h>
 #include <tyrdbs/location.h>
+#include <tyrdbs/key_buffer.h>
 
 #include <crc32c.h>
 
@@ -10,6 +12,21 @@ namespace tyrtech::tyrdbs {
 
 thread_local uint64_t slice_count{0};
 
+thread_local uint32_t readahead_window{slice::default_readahead_window};
+thread_local uint32_t readahead_leaves{0};
+
+
+struct readahead
+{
+    cache::node_ptr node;
+
+    uint32_t ahead{0};
+
+    bool running{false};
+    bool finished{false};
+    bool cancelled{false};
+};
+
 
 class slice_iterator : public iterator
 {
@@ -24,6 +41,7 @@ public:
 
 public:
     slice_iterator(slice* slice, std::shared_ptr<node> node, uint16_t ndx);
+    ~slice_iterator() override;
 
 private:
     slice* m_slice{nullptr};
@@ -33,8 +51,19 @@ private:
 
     const data_attributes* m_attrs{nullptr};
 
+    key_buffer m_key_buffer;
+    std::string_view m_key;
+
+    uint32_t m_sequential_loads{0};
+    std::shared_ptr<readahead> m_readahead;
+
 private:
     bool load_next();
+    void read_ahead();
+
+    static void prefetch(std::shared_ptr<const slice> slice,
+                         std::shared_ptr<readahead> readahead,
+                         uint32_t leaves);
 };
 
 bool slice_iterator::next()
@@ -47,6 +76,8 @@ bool slice_iterator::next()
     if (m_attrs == nullptr)
     {
         m_attrs = m_node->attributes_at<data_attributes>(m_ndx);
+        m_key = m_node->key_at(m_ndx, &m_key_buffer);
+
         return true;
     }
 
@@ -66,13 +97,14 @@ bool slice_iterator::next()
     m_ndx++;
 
     m_attrs = m_node->attributes_at<data_attributes>(m_ndx);
+    m_key = m_node->next_key_at(m_ndx, &m_key_buffer);
 
     return true;
 }
 
 std::string_view slice_iterator::key() const
 {
-    return m_node->key_at(m_ndx);
+    return m_key;
 }
 
 std::string_view slice_iterator::value() const
@@ -103,28 +135,206 @@ slice_iterator::slice_iterator(slice* slice, cache::node_ptr node, uint16_t ndx)
     assert(likely(ndx < m_node->key_count()));
 }
 
+slice_iterator::~slice_iterator()
+{
+    if (m_readahead != nullptr)
+    {
+        m_readahead->cancelled = true;
+    }
+}
+
 bool slice_iterator::load_next()
 {
-    while (true)
+    m_node = m_slice->load_next_leaf(m_node);
+
+    if (m_node == nullptr)
     {
-        uint64_t location = m_node->get_next();
+        return false;
+    }
 
-        if (location::is_valid(location) == false)
+    if (++m_sequential_loads >= slice::readahead_trigger)
+    {
+        read_ahead();
+    }
+
+    return true;
+}
+
+void slice_iterator::read_ahead()
+{
+    if (readahead_window == 0 || cache::enabled() == false)
+    {
+        return;
+    }
+
+    if (m_readahead == nullptr)
+    {
+        m_readahead = std::make_shared<readahead>();
+    }
+
+    auto& r = *m_readahead;
+
+    if (r.ahead != 0)
+    {
+        r.ahead--;
+    }
+    else if (r.running == false)
+    {
+        r.node = m_node;
+    }
+
+    if (r.running == true || r.finished == true || r.ahead > (readahead_window >> 1))
+    {
+        return;
+    }
+
+    uint32_t leaves = readahead_window - r.ahead;
+
+    if (readahead_leaves + leaves > slice::max_readahead_leaves)
+    {
+        return;
+    }
+
+    readahead_leaves += leaves;
+    r.running = true;
+
+    gt::create_thread(&slice_iterator::prefetch,
+                      m_slice->shared_from_this(),
+                      m_readahead,
+                      leaves);
+}
+
+void slice_iterator::prefetch(std::shared_ptr<const slice> slice,
+                              std::shared_ptr<readahead> readahead,
+                              uint32_t leaves)
+{
+    auto& r = *readahead;
+
+    try
+    {
+        while (leaves != 0 && r.cancelled == false)
         {
-            return false;
+            auto node = slice->load_next_leaf(r.node);
+
+            if (node == nullptr)
+            {
+                r.finished = true;
+                break;
+            }
+
+            r.node = std::move(node);
+            r.ahead++;
+
+            readahead_leaves--;
+            leaves--;
         }
+    }
+    catch (exception&)
+    {
+        r.finished = true;
+    }
 
-        m_node = m_slice->load(location);
+    readahead_leaves -= leaves;
+    r.running = false;
+}
 
-        if (location::is_leaf_from(location) == true)
+
+class slice_key_iterator : public iterator
+{
+public:
+    bool next() override;
+
+    std::string_view key() const override;
+    std::string_view value() const override;
+    bool eor() const override;
+    bool deleted() const override;
+    uint64_t idx() const override;
+
+public:
+    slice_key_iterator(std::shared_ptr<slice> slice, std::shared_ptr<node> node, uint16_t ndx);
+
+private:
+    std::shared_ptr<slice> m_slice;
+
+    std::shared_ptr<node> m_node;
+    uint16_t m_ndx{static_cast<uint16_t>(-1)};
+
+    bool m_started{false};
+
+    key_buffer m_key_buffer;
+    std::string_view m_key;
+};
+
+bool slice_key_iterator::next()
+{
+    if (m_started == false)
+    {
+        m_started = true;
+        m_key = m_node->key_at(m_ndx, &m_key_buffer);
+
+        return true;
+    }
+
+    if (m_node == nullptr || m_node->eor_at(m_ndx) == true)
+    {
+        m_node.reset();
+        return false;
+    }
+
+    if (m_ndx == m_node->key_count() - 1)
+    {
+        m_node = m_slice->load_next_leaf(m_node);
+
+        if (m_node == nullptr)
         {
-            break;
+            return false;
         }
+
+        m_ndx = static_cast<uint16_t>(-1);
     }
 
+    m_ndx++;
+
+    m_key = m_node->next_key_at(m_ndx, &m_key_buffer);
+
     return true;
 }
 
+std::string_view slice_key_iterator::key() const
+{
+    return m_key;
+}
+
+std::string_view slice_key_iterator::value() const
+{
+    return m_node->value_at(m_ndx);
+}
+
+bool slice_key_iterator::eor() const
+{
+    return m_node->eor_at(m_ndx);
+}
+
+bool slice_key_iterator::deleted() const
+{
+    return m_node->deleted_at(m_ndx);
+}
+
+uint64_t slice_key_iterator::idx() const
+{
+    return m_node->attributes_at<data_attributes>(m_ndx)->idx;
+}
+
+slice_key_iterator::slice_key_iterator(std::shared_ptr<slice> slice,
+                                       std::shared_ptr<node> node,
+                                       uint16_t ndx)
+  : m_slice(std::move(slice))
+  , m_node(std::move(node))
+  , m_ndx(ndx)
+{
+    assert(likely(ndx < m_node->key_count()));
+}
+
 std::unique_ptr<iterator> slice::range(const std::string_view& min_key, const std::string_view& max_key)
 {
     if (unlikely(key_count() == 0))
@@ -134,6 +344,11 @@ std::unique_ptr<iterator> slice::range(const std::string_view& min_key, const st
 
     assert(likely(min_key.compare(max_key) <= 0));
 
+    if (min_key.compare(max_key) == 0 && may_contain(min_key) == false)
+    {
+        return nullptr;
+    }
+
     uint64_t location = find_node_for(m_root, min_key, max_key);
 
     if (location::is_valid(location) == false)
@@ -160,6 +375,48 @@ std::unique_ptr<iterator> slice::begin()
     return std::make_unique<slice_iterator>(this, std::move(node), 0);
 }
 
+bool slice::may_contain(const std::string_view& key) const
+{
+    return m_bloom_filter.may_contain(key);
+}
+
+std::unique_ptr<iterator> slice::get(const std::string_view& key)
+{
+    if (unlikely(key_count() == 0))
+    {
+        return nullptr;
+    }
+
+    if (may_contain(key) == false)
+    {
+        return nullptr;
+    }
+
+    uint64_t location = find_node_for(m_root, key, key);
+
+    if (location::is_valid(location) == false)
+    {
+        return nullptr;
+    }
+
+    auto&& node = load(location);
+    uint16_t ndx = node->lower_bound(key);
+
+    if (ndx == node->key_count())
+    {
+        return nullptr;
+    }
+
+    key_buffer buffer;
+
+    if (key.compare(node->key_at(ndx, &buffer)) != 0)
+    {
+        return nullptr;
+    }
+
+    return std::make_unique<slice_key_iterator>(shared_from_this(), std::move(node), ndx);
+}
+
 void slice::unlink()
 {
     assert(likely(m_unlink == false));
@@ -171,16 +428,31 @@ uint64_t slice::key_count() const
     return m_key_count;
 }
 
+uint64_t slice::max_idx() const
+{
+    return m_max_idx;
+}
+
 const storage::extents_t& slice::extents() const
 {
     return m_reader.extents();
 }
 
+const storage::file_descriptor& slice::descriptor() const
+{
+    return m_reader.descriptor();
+}
+
 uint64_t slice::count()
 {
     return slice_count;
 }
 
+void slice::set_readahead_window(uint32_t leaves)
+{
+    readahead_window = leaves;
+}
+
 slice::slice(storage::file_reader&& reader)
   : m_slice_ndx(storage::new_cache_id())
   , m_reader(std::move(reader))
@@ -200,9 +472,20 @@ slice::slice(storage::file_reader&& reader)
     }
 
     m_key_count = h.stats.key_count;
+    m_max_idx = h.stats.max_idx;
 
     m_root = h.root;
     m_first_node_size = h.first_node_size;
+    m_key_encoding = h.key_encoding;
+
+    if (h.bloom_filter_size != 0)
+    {
+        bloom_filter::data_t data(h.bloom_filter_size);
+
+        m_reader.pread(h.bloom_filter_offset, data.data(), data.size());
+
+        m_bloom_filter = bloom_filter(std::move(data));
+    }
 
     slice_count++;
 }
@@ -220,13 +503,39 @@ slice::~slice()
 
 cache::node_ptr slice::load(uint64_t location) const
 {
-    return cache::get(m_reader, m_slice_ndx, location);
+    return cache::get(m_reader, m_slice_ndx, location, m_key_encoding);
+}
+
+cache::node_ptr slice::load_next_leaf(const cache::node_ptr& node) const
+{
+    cache::node_ptr next_node = node;
+
+    while (true)
+    {
+        uint64_t location = next_node->get_next();
+
+        if (location::is_valid(location) == false)
+        {
+            return nullptr;
+        }
+
+        next_node = load(location);
+
+        if (location::is_leaf_from(location) == true)
+        {
+            break;
+        }
+    }
+
+    return next_node;
 }
 
 uint64_t slice::find_node_for(uint64_t location,
                                const std::string_view& min_key,
                                const std::string_view& max_key) const
 {
+    key_buffer buffer;
+
     while (true)
     {
         auto&& node = load(location);
@@ -234,20 +543,24 @@ uint64_t slice::find_node_for(uint64_t location,
 
         if (ndx != node->key_count())
         {
-            int32_t cmp = min_key.compare(node->key_at(ndx));
+            int32_t cmp = min_key.compare(node->key_at(ndx, &buffer));
             assert(likely(cmp <= 0));
 
             if (cmp < 0 && ndx != 0)
             {
                 ndx--;
             }
+            else if (cmp == 0 && ndx != 0 && min_key.compare(node->value_at(ndx - 1)) <= 0)
+            {
+                ndx--;
+            }
         }
         else
         {
             ndx--;
         }
 
-        auto index_min_key = node->key_at(ndx);
+        auto index_min_key = node->key_at(ndx, &buffer);
         auto index_max_key = node->value_at(ndx);
 
         if (min_key.compare(index_max_key) > 0)
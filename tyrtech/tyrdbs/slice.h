@@ -3,6 +3,7 @@
 
 #include <storage/engine.h>
 #include <tyrdbs/node.h>
+#include <tyrdbs/bloom_filter.h>
 #include <tyrdbs/attributes.h>
 #include <tyrdbs/iterator.h>
 
@@ -10,8 +11,11 @@
 namespace tyrtech::tyrdbs {
 
 
-class slice : private disallow_copy, disallow_move
+class slice : public std::enable_shared_from_this<slice>, private disallow_copy, disallow_move
 {
+public:
+    static constexpr uint32_t default_readahead_window{8};
+
 public:
     struct stats
     {
@@ -20,20 +24,28 @@ public:
         uint64_t uncompressed_size{0};
         uint64_t total_nodes{0};
         uint64_t leaf_nodes{0};
+        uint64_t max_idx{0};
     } __attribute__ ((packed));
 
 public:
     std::unique_ptr<iterator> range(const std::string_view& min_key, const std::string_view& max_key);
     std::unique_ptr<iterator> begin();
+    std::unique_ptr<iterator> get(const std::string_view& key);
+
+    bool may_contain(const std::string_view& key) const;
 
     void unlink();
 
     uint64_t key_count() const;
+    uint64_t max_idx() const;
     const storage::extents_t& extents() const;
+    const storage::file_descriptor& descriptor() const;
 
 public:
     static uint64_t count();
 
+    static void set_readahead_window(uint32_t leaves);
+
 public:
     slice() = default;
     slice(storage::file_reader&& reader);
@@ -43,6 +55,9 @@ public:
 private:
     static constexpr uint64_t signature{0x3130306264727974UL};
 
+    static constexpr uint32_t readahead_trigger{2};
+    static constexpr uint32_t max_readahead_leaves{256};
+
 public:
     struct header
     {
@@ -50,6 +65,9 @@ public:
         uint64_t root{static_cast<uint64_t>(-1)};
         uint16_t first_node_size{static_cast<uint16_t>(-1)};
         stats stats;
+        uint64_t bloom_filter_offset{0};
+        uint32_t bloom_filter_size{0};
+        node::key_encoding key_encoding{node::key_encoding::plain};
     } __attribute__ ((packed));
 
 private:
@@ -58,10 +76,15 @@ private:
     storage::file_reader m_reader;
 
     uint64_t m_key_count{0};
+    uint64_t m_max_idx{0};
 
     uint64_t m_root{static_cast<uint64_t>(-1)};
     uint64_t m_first_node_size{0};
 
+    node::key_encoding m_key_encoding{node::key_encoding::plain};
+
+    bloom_filter m_bloom_filter;
+
     bool m_unlink{false};
 
 private:
@@ -70,10 +93,12 @@ private:
                            const std::string_view& max_key) const;
 
     std::shared_ptr<node> load(uint64_t location) const;
+    std::shared_ptr<node> load_next_leaf(const std::shared_ptr<node>& node) const;
 
 private:
     friend class slice_writer;
     friend class slice_iterator;
+    friend class slice_key_iterator;
 };
 
 }
@@ -10,6 +10,9 @@ namespace tyrtech::tyrdbs {
 
 extern thread_local uint64_t slice_count;
 
+thread_local uint32_t bloom_filter_bits{slice_writer::default_bloom_filter_bits};
+thread_local node::key_encoding key_encoding{slice_writer::default_key_encoding};
+
 
 void slice_writer::index_writer::add(const std::string_view& min_key,
                                      const std::string_view& max_key,
@@ -64,7 +67,8 @@ uint64_t slice_writer::index_writer::flush()
 }
 
 slice_writer::index_writer::index_writer(slice_writer* writer)
-  : m_writer(writer)
+  : m_node(writer->m_key_encoding)
+  , m_writer(writer)
 {
 }
 
@@ -94,9 +98,9 @@ void slice_writer::add(const std::string_view& key,
 
     bool new_key = check(key, value, eor, deleted);
 
-    if (new_key == true && m_first_key.size() == 0)
+    if (new_key == true)
     {
-        m_first_key.assign(key);
+        m_bloom_filter.add(key);
     }
 
     while (true)
@@ -106,6 +110,13 @@ void slice_writer::add(const std::string_view& key,
 
         if (auto res = m_node.add(key, value, eor, deleted, attributes, false); res != -1)
         {
+            if (new_key == true && m_first_key.size() == 0)
+            {
+                m_first_key.assign(key);
+            }
+
+            m_last_key.assign(key);
+
             value = value.substr(res, value.size() - res);
 
             if (value.size() == 0)
@@ -119,15 +130,7 @@ void slice_writer::add(const std::string_view& key,
         if (m_first_key.size() != 0)
         {
             m_index.add(m_first_key.data(), m_last_key.data(), location);
-
-            if (new_key == true)
-            {
-                m_first_key.assign(key);
-            }
-            else
-            {
-                m_first_key.clear();
-            }
+            m_first_key.clear();
         }
     }
 
@@ -135,6 +138,11 @@ void slice_writer::add(const std::string_view& key,
     m_last_eor = eor;
 
     m_header.stats.key_count++;
+
+    if (idx > m_header.stats.max_idx)
+    {
+        m_header.stats.max_idx = idx;
+    }
 }
 
 void slice_writer::flush()
@@ -162,6 +170,19 @@ void slice_writer::flush()
     m_last_node->set_next(location::invalid_size);
 
     m_writer.write(location::invalid_size);
+
+    m_header.key_encoding = m_key_encoding;
+
+    m_bloom_filter_data = m_bloom_filter.flush();
+
+    if (m_bloom_filter_data.size() != 0)
+    {
+        m_header.bloom_filter_offset = m_writer.size();
+        m_header.bloom_filter_size = m_bloom_filter_data.size();
+
+        m_writer.write(m_bloom_filter_data.data(), m_bloom_filter_data.size());
+    }
+
     m_writer.add_padding();
 
     m_writer.write(m_header);
@@ -182,15 +203,31 @@ std::shared_ptr<slice> slice_writer::commit()
     c->m_slice_ndx = m_slice_ndx;
     c->m_reader = storage::create_reader(m_writer.commit());
     c->m_key_count = m_header.stats.key_count;
+    c->m_max_idx = m_header.stats.max_idx;
     c->m_root = m_header.root;
     c->m_first_node_size = m_header.first_node_size;
+    c->m_key_encoding = m_header.key_encoding;
+    c->m_bloom_filter = bloom_filter(std::move(m_bloom_filter_data));
 
     return c;
 }
 
+void slice_writer::set_bloom_filter_bits(uint32_t bits_per_key)
+{
+    bloom_filter_bits = bits_per_key;
+}
+
+void slice_writer::set_key_encoding(node::key_encoding encoding)
+{
+    key_encoding = encoding;
+}
+
 slice_writer::slice_writer()
   : m_slice_ndx(storage::new_cache_id())
   , m_writer(storage::create_writer())
+  , m_key_encoding(key_encoding)
+  , m_node(m_key_encoding)
+  , m_bloom_filter(bloom_filter_bits)
 {
     slice_count++;
 }
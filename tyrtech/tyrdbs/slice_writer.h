@@ -3,6 +3,7 @@
 
 #include <tyrdbs/slice.h>
 #include <tyrdbs/node_writer.h>
+#include <tyrdbs/bloom_filter_writer.h>
 #include <tyrdbs/key_buffer.h>
 
 
@@ -16,6 +17,12 @@ public:
 
 public:
     static constexpr uint64_t max_idx{0x1000000000000ULL};
+    static constexpr uint32_t default_bloom_filter_bits{10};
+    static constexpr node::key_encoding default_key_encoding{node::key_encoding::prefix};
+
+public:
+    static void set_bloom_filter_bits(uint32_t bits_per_key);
+    static void set_key_encoding(node::key_encoding encoding);
 
 public:
     void add(iterator* it, bool compact);
@@ -72,11 +79,16 @@ private:
 
     storage::file_writer m_writer;
 
+    node::key_encoding m_key_encoding{node::key_encoding::plain};
+
     node_writer m_node;
     index_writer m_index{this};
 
     slice::header m_header;
 
+    bloom_filter_writer m_bloom_filter;
+    bloom_filter::data_t m_bloom_filter_data;
+
     std::shared_ptr<node> m_last_node;
 
 private:
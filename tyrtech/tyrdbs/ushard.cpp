@@ -5,6 +5,9 @@
 namespace tyrtech::tyrdbs {
 
 
+thread_local uint64_t memtable_size{ushard::default_memtable_size};
+
+
 class ushard_iterator : public iterator
 {
 public:
@@ -18,49 +21,76 @@ public:
 
 public:
     ushard_iterator(ushard::slices_t&& slices,
+                    ushard::memtables_t&& memtables,
                     const std::string_view& min_key,
                     const std::string_view& max_key);
-    ushard_iterator(ushard::slices_t&& slices);
+    ushard_iterator(ushard::slices_t&& slices,
+                    ushard::memtables_t&& memtables);
 
 private:
-    using element_t =
-            std::pair<ushard::slice_ptr, std::unique_ptr<iterator>>;
+    struct element
+    {
+        ushard::slice_ptr slice;
+        std::unique_ptr<iterator> it;
+
+        std::string_view key;
+        uint64_t idx{0};
+
+        bool valid{true};
+
+        element(ushard::slice_ptr slice, std::unique_ptr<iterator> it);
+
+        bool next();
+    };
 
     using elements_t =
-            std::vector<element_t>;
+            std::vector<element>;
+
+    using tree_t =
+            std::vector<uint16_t>;
 
 private:
     elements_t m_elements;
+    tree_t m_tree;
 
     key_buffer m_max_key;
     key_buffer m_last_key;
 
-private:
-    struct cmp
-    {
-        bool operator()(const element_t& e1, const element_t& e2)
-        {
-            auto& it1 = e1.second;
-            auto& it2 = e2.second;
-
-            int32_t cmp = it1->key().compare(it2->key());
-
-            if (cmp == 0)
-            {
-                return it1->idx() < it2->idx();
-            }
-
-            return cmp > 0;
-        }
-    };
-
 private:
     bool is_out_of_bounds();
 
     bool advance_last();
     bool advance();
+
+    bool before(uint16_t e1, uint16_t e2) const;
+
+    uint16_t build(uint32_t node);
+    void replay(uint16_t ndx);
+
+    const element& winner() const;
 };
 
+ushard_iterator::element::element(ushard::slice_ptr slice, std::unique_ptr<iterator> it)
+  : slice(std::move(slice))
+  , it(std::move(it))
+  , key(this->it->key())
+  , idx(this->it->idx())
+{
+}
+
+bool ushard_iterator::element::next()
+{
+    valid = it->next();
+
+    if (valid == true)
+    {
+        key = it->key();
+        idx = it->idx();
+    }
+
+    return valid;
+}
+
 bool ushard_iterator::next()
 {
     if (m_elements.size() == 0)
@@ -70,8 +100,10 @@ bool ushard_iterator::next()
 
     if (m_last_key.size() == 0)
     {
-        std::sort(m_elements.begin(), m_elements.end(), cmp());
-        m_last_key.assign(m_elements.back().second->key());
+        m_tree.resize(m_elements.size());
+        m_tree[0] = build(1);
+
+        m_last_key.assign(key());
 
         if (is_out_of_bounds() == true)
         {
@@ -105,39 +137,57 @@ bool ushard_iterator::next()
         }
     }
 
+    m_elements.clear();
+
     return false;
 }
 
 std::string_view ushard_iterator::key() const
 {
-    return m_elements.back().second->key();
+    return winner().key;
 }
 
 std::string_view ushard_iterator::value() const
 {
-    return m_elements.back().second->value();
+    return winner().it->value();
 }
 
 bool ushard_iterator::eor() const
 {
-    return m_elements.back().second->eor();
+    return winner().it->eor();
 }
 
 bool ushard_iterator::deleted() const
 {
-    return m_elements.back().second->deleted();
+    return winner().it->deleted();
 }
 
 uint64_t ushard_iterator::idx() const
 {
-    return m_elements.back().second->idx();
+    return winner().idx;
 }
 
 ushard_iterator::ushard_iterator(ushard::slices_t&& slices,
+                                 ushard::memtables_t&& memtables,
                                  const std::string_view& min_key,
                                  const std::string_view& max_key)
 {
-    m_elements.reserve(slices.size());
+    m_elements.reserve(slices.size() + memtables.size());
+
+    for (auto&& memtable : memtables)
+    {
+        auto&& it = memtable->range(min_key, max_key);
+
+        if (it == nullptr)
+        {
+            continue;
+        }
+
+        if (it->next() == true)
+        {
+            m_elements.emplace_back(nullptr, std::move(it));
+        }
+    }
 
     auto jobs = gt::async::create_jobs();
 
@@ -162,8 +212,7 @@ ushard_iterator::ushard_iterator(ushard::slices_t&& slices,
                 return;
             }
 
-            this->m_elements.emplace_back(element_t(std::move(slice),
-                                                    std::move(it)));
+            this->m_elements.emplace_back(std::move(slice), std::move(it));
         };
 
         jobs.run(std::move(f));
@@ -177,9 +226,25 @@ ushard_iterator::ushard_iterator(ushard::slices_t&& slices,
     }
 }
 
-ushard_iterator::ushard_iterator(ushard::slices_t&& slices)
+ushard_iterator::ushard_iterator(ushard::slices_t&& slices,
+                                 ushard::memtables_t&& memtables)
 {
-    m_elements.reserve(slices.size());
+    m_elements.reserve(slices.size() + memtables.size());
+
+    for (auto&& memtable : memtables)
+    {
+        auto&& it = memtable->begin();
+
+        if (it == nullptr)
+        {
+            continue;
+        }
+
+        if (it->next() == true)
+        {
+            m_elements.emplace_back(nullptr, std::move(it));
+        }
+    }
 
     for (auto&& slice : slices)
     {
@@ -192,8 +257,7 @@ ushard_iterator::ushard_iterator(ushard::slices_t&& slices)
 
         if (it->next() == true)
         {
-            this->m_elements.emplace_back(element_t(std::move(slice),
-                                                    std::move(it)));
+            this->m_elements.emplace_back(std::move(slice), std::move(it));
         }
     }
 }
@@ -210,44 +274,159 @@ bool ushard_iterator::is_out_of_bounds()
 
 bool ushard_iterator::advance_last()
 {
-    return m_elements.back().second->next();
+    return m_elements[m_tree[0]].next();
 }
 
 bool ushard_iterator::advance()
 {
-    bool has_next = advance_last();
+    advance_last();
+    replay(m_tree[0]);
+
+    return winner().valid;
+}
+
+bool ushard_iterator::before(uint16_t e1, uint16_t e2) const
+{
+    auto& element1 = m_elements[e1];
+    auto& element2 = m_elements[e2];
+
+    if (element2.valid == false)
+    {
+        return true;
+    }
+
+    if (element1.valid == false)
+    {
+        return false;
+    }
+
+    int32_t cmp = element1.key.compare(element2.key);
+
+    if (cmp == 0)
+    {
+        return element1.idx > element2.idx;
+    }
 
-    if (has_next == false)
+    return cmp < 0;
+}
+
+uint16_t ushard_iterator::build(uint32_t node)
+{
+    if (node >= m_tree.size())
     {
-        m_elements.pop_back();
-        return m_elements.size() != 0;
+        return node - m_tree.size();
     }
 
-    auto&& it = std::lower_bound(m_elements.begin(),
-                                 m_elements.end(),
-                                 m_elements.back(),
-                                 cmp());
+    uint16_t e1 = build(node << 1);
+    uint16_t e2 = build((node << 1) + 1);
 
-    if (it != --m_elements.end())
+    if (before(e1, e2) == true)
     {
-        element_t e = std::move(m_elements.back());
-        m_elements.insert(it, std::move(e));
+        m_tree[node] = e2;
+        return e1;
+    }
+
+    m_tree[node] = e1;
+    return e2;
+}
 
-        m_elements.pop_back();
+void ushard_iterator::replay(uint16_t ndx)
+{
+    uint16_t winner = ndx;
+
+    for (uint32_t node = (ndx + m_tree.size()) >> 1; node != 0; node >>= 1)
+    {
+        if (before(m_tree[node], winner) == true)
+        {
+            std::swap(m_tree[node], winner);
+        }
     }
 
-    return true;
+    m_tree[0] = winner;
+}
+
+const ushard_iterator::element& ushard_iterator::winner() const
+{
+    return m_elements[m_tree[0]];
 }
 
 std::unique_ptr<iterator> ushard::range(const std::string_view& min_key,
                                         const std::string_view& max_key)
 {
-    return std::make_unique<ushard_iterator>(get_slices(), min_key, max_key);
+    auto&& slices = get_slices();
+
+    if (min_key.compare(max_key) == 0)
+    {
+        auto it = std::remove_if(slices.begin(),
+                                 slices.end(),
+                                 [&min_key](const slice_ptr& slice)
+                                 {
+                                     return slice->may_contain(min_key) == false;
+                                 });
+
+        slices.erase(it, slices.end());
+    }
+
+    return std::make_unique<ushard_iterator>(std::move(slices),
+                                             get_memtables(),
+                                             min_key,
+                                             max_key);
 }
 
 std::unique_ptr<iterator> ushard::begin()
 {
-    return std::make_unique<ushard_iterator>(get_slices());
+    return std::make_unique<ushard_iterator>(get_slices(), get_memtables());
+}
+
+std::unique_ptr<iterator> ushard::get(const std::string_view& key)
+{
+    auto&& slices = get_slices();
+
+    auto cmp = [](const slice_ptr& s1, const slice_ptr& s2)
+    {
+        return s1->max_idx() > s2->max_idx();
+    };
+
+    std::sort(slices.begin(), slices.end(), cmp);
+
+    std::unique_ptr<iterator> it;
+
+    for (auto&& memtable : get_memtables())
+    {
+        auto&& memtable_it = memtable->get(key);
+
+        if (memtable_it == nullptr)
+        {
+            continue;
+        }
+
+        if (it == nullptr || memtable_it->idx() > it->idx())
+        {
+            it = std::move(memtable_it);
+        }
+    }
+
+    for (auto&& slice : slices)
+    {
+        if (it != nullptr && slice->max_idx() <= it->idx())
+        {
+            break;
+        }
+
+        auto&& slice_it = slice->get(key);
+
+        if (slice_it == nullptr)
+        {
+            continue;
+        }
+
+        if (it == nullptr || slice_it->idx() > it->idx())
+        {
+            it = std::move(slice_it);
+        }
+    }
+
+    return it;
 }
 
 void ushard::add(slice_ptr slice, meta_callback* cb)
@@ -255,6 +434,45 @@ void ushard::add(slice_ptr slice, meta_callback* cb)
     add(std::move(slice), cb, true);
 }
 
+void ushard::load(slice_ptr slice, meta_callback* cb)
+{
+    add(std::move(slice), cb, false);
+}
+
+void ushard::add(iterator* it, meta_callback* cb)
+{
+    m_memtable->add(it);
+
+    if (m_memtable->size() >= memtable_size)
+    {
+        flush(cb);
+    }
+}
+
+void ushard::flush(meta_callback* cb)
+{
+    if (m_memtable->key_count() == 0)
+    {
+        return;
+    }
+
+    auto memtable = std::move(m_memtable);
+
+    m_memtable = std::make_shared<tyrdbs::memtable>();
+    m_frozen.push_back(memtable);
+
+    slice_writer target;
+
+    auto&& it = memtable->begin();
+
+    target.add(it.get(), false);
+    target.flush();
+
+    add(target.commit(), cb);
+
+    m_frozen.erase(std::find(m_frozen.begin(), m_frozen.end(), memtable));
+}
+
 uint64_t ushard::merge(uint32_t tier, meta_callback* cb)
 {
     auto&& tier_slices = get_slices_for(tier);
@@ -265,17 +483,17 @@ uint64_t ushard::merge(uint32_t tier, meta_callback* cb)
         return 0;
     }
 
-    cb->remove(tier_slices);
-
     auto source_key_count = key_count(tier_slices);
 
     slice_writer target;
-    ushard_iterator it(std::move(tier_slices));
+    ushard_iterator it(get_slices_for(tier), memtables_t());
 
     target.add(&it, false);
     target.flush();
 
     add(target.commit(), cb);
+    cb->remove(tier_slices);
+
     remove_from(tier, count, cb);
 
     return source_key_count;
@@ -290,19 +508,18 @@ uint64_t ushard::compact(meta_callback* cb)
         return 0;
     }
 
-    cb->remove(slices);
-
     auto source_key_count = key_count(slices);
 
     tier_map_t tier_map_checkpoint = m_tier_map;
 
     slice_writer target;
-    ushard_iterator it(std::move(slices));
+    ushard_iterator it(get_slices(), memtables_t());
 
     target.add(&it, true);
     target.flush();
 
     add(target.commit(), cb);
+    cb->remove(slices);
 
     for (auto&& it : tier_map_checkpoint)
     {
@@ -331,6 +548,28 @@ ushard::slices_t ushard::get_slices() const
     return slices;
 }
 
+ushard::memtables_t ushard::get_memtables() const
+{
+    memtables_t memtables(m_frozen);
+
+    if (m_memtable->key_count() != 0)
+    {
+        memtables.push_back(m_memtable);
+    }
+
+    return memtables;
+}
+
+void ushard::set_memtable_size(uint64_t size)
+{
+    memtable_size = size;
+}
+
+ushard::ushard()
+  : m_memtable(std::make_shared<tyrdbs::memtable>())
+{
+}
+
 ushard::~ushard()
 {
     if (m_dropped == false)
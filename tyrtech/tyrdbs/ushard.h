@@ -2,6 +2,7 @@
 
 
 #include <tyrdbs/slice_writer.h>
+#include <tyrdbs/memtable.h>
 
 
 namespace tyrtech::tyrdbs {
@@ -11,6 +12,10 @@ class ushard : private disallow_copy, disallow_move
 {
 public:
     static constexpr uint32_t max_slices_per_tier{4};
+    static constexpr uint64_t default_memtable_size{4UL << 20};
+
+public:
+    static void set_memtable_size(uint64_t size);
 
 public:
     using slice_ptr =
@@ -19,6 +24,12 @@ public:
     using slices_t =
             std::vector<slice_ptr>;
 
+    using memtable_ptr =
+            std::shared_ptr<memtable>;
+
+    using memtables_t =
+            std::vector<memtable_ptr>;
+
 public:
     struct meta_callback
     {
@@ -34,8 +45,13 @@ public:
     std::unique_ptr<iterator> range(const std::string_view& min_key,
                                     const std::string_view& max_key);
     std::unique_ptr<iterator> begin();
+    std::unique_ptr<iterator> get(const std::string_view& key);
 
     void add(slice_ptr slice, meta_callback* cb);
+    void load(slice_ptr slice, meta_callback* cb);
+
+    void add(iterator* it, meta_callback* cb);
+    void flush(meta_callback* cb);
 
     uint64_t merge(uint32_t tier, meta_callback* cb);
     uint64_t compact(meta_callback* cb);
@@ -43,8 +59,10 @@ public:
     void drop();
 
     slices_t get_slices() const;
+    memtables_t get_memtables() const;
 
 public:
+    ushard();
     ~ushard();
 
 private:
@@ -53,6 +71,9 @@ private:
 
 private:
     tier_map_t m_tier_map;
+
+    memtable_ptr m_memtable;
+    memtables_t m_frozen;
     bool m_dropped{false};
 
 private: